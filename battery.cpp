@@ -0,0 +1,40 @@
+#include "battery.h"
+
+BatteryCompensation::BatteryCompensation(float nominal)
+{
+    this->nominal = nominal;
+    filtered = 0;
+    lastTime = 0;
+    factor = 1;
+    low = 0;
+    high = 1;
+}
+
+void BatteryCompensation::update(float volts, double now)
+{
+    if(volts < BATTERY_LOWEST || volts > BATTERY_HIGHEST) return;
+
+    // The first good reading is taken as it is, the rest are smoothed
+    if(filtered == 0) filtered = volts;
+    else
+    {
+        double dt = now - lastTime;
+        filtered += (volts - filtered) * (float)(dt / (BATTERY_FILTER + dt));
+    }
+    lastTime = now;
+
+    factor = nominal / filtered;
+    if(factor < BATTERY_MIN_SCALE) factor = BATTERY_MIN_SCALE;
+    if(factor > BATTERY_MAX_SCALE) factor = BATTERY_MAX_SCALE;
+
+    if(low == 0 || filtered < low) low = filtered;
+    if(factor > high) high = factor;
+}
+
+float BatteryCompensation::apply(float percent) const
+{
+    float scaled = percent * factor;
+    if(scaled > 100) return 100;
+    if(scaled < -100) return -100;
+    return scaled;
+}
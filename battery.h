@@ -0,0 +1,53 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+
+// Readings outside this aren't the pack (running off USB, a loose lead), and
+// commands go out as they are until there's a good one
+#define BATTERY_LOWEST 6.0
+#define BATTERY_HIGHEST 14.0
+
+// Seconds the filtered voltage takes to get most of the way to a change, so
+// a motor starting doesn't jerk the others
+#define BATTERY_FILTER 0.5
+
+// Most a command gets cut on a fresh pack and raised on a flat one
+#define BATTERY_MIN_SCALE 0.8
+#define BATTERY_MAX_SCALE 1.3
+
+// Scales motor commands by the pack voltage, so a percent gives the speed it
+// gave at the nominal voltage the settings were tuned at. Motor speed goes
+// with the voltage it sees, which is the percent times the pack.
+class BatteryCompensation
+{
+public:
+    BatteryCompensation(float nominal);
+
+    // Give it a voltage read off the pack
+    void update(float volts, double now);
+
+    // Whether there has been a good reading yet
+    bool known() const { return filtered > 0; }
+
+    // Filtered pack voltage, 0 until it's known
+    float volts() const { return filtered; }
+
+    // What commands get multiplied by right now
+    float scale() const { return factor; }
+
+    // The command that gives a percent's nominal speed, limited to the motor's range
+    float apply(float percent) const;
+
+    // Lowest the pack got and the most a command got raised, for the report
+    float lowest() const { return low; }
+    float highestScale() const { return high; }
+
+private:
+    float nominal;
+    float filtered;
+    double lastTime;
+    float factor;
+    float low;
+    float high;
+};
+
+#endif // BATTERY_H
@@ -0,0 +1,28 @@
+#include "calibration.h"
+#include "settingsfile.h"
+
+// Name of every setting in the file and where it goes
+static const SettingsField fields[] = {
+    { "countsPerTurn", offsetof(Calibration, countsPerTurn) },
+    { "inchesPerCount", offsetof(Calibration, inchesPerCount) },
+    { "leftGain", offsetof(Calibration, leftGain) },
+    { "rightGain", offsetof(Calibration, rightGain) },
+    { "leftDeadband", offsetof(Calibration, leftDeadband) },
+    { "rightDeadband", offsetof(Calibration, rightDeadband) },
+    { "encoderLow", offsetof(Calibration, encoderLow) },
+    { "encoderHigh", offsetof(Calibration, encoderHigh) },
+    { "liftLow", offsetof(Calibration, liftLow) },
+    { "liftHigh", offsetof(Calibration, liftHigh) },
+};
+
+static const int numFields = sizeof(fields) / sizeof(SettingsField);
+
+bool loadCalibration(const char *name, Calibration &calibration)
+{
+    return loadSettings(name, fields, numFields, &calibration);
+}
+
+bool saveCalibration(const char *name, const Calibration &calibration)
+{
+    return saveSettings(name, fields, numFields, &calibration);
+}
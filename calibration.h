@@ -0,0 +1,30 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+// File the calibration profile lives in on the SD card
+#define CALIBRATION_FILE "CALIB.TXT"
+
+// Numbers measured on the robot instead of compiled in. The profile is a text
+// file with one "name value" line per setting, anything missing from it keeps
+// the value it had.
+struct Calibration
+{
+    float countsPerTurn; // wheel counts for a full pivot in place
+    float inchesPerCount; // how far the robot rolls for one wheel count
+    float leftGain; // counts per second for every percent over the deadband
+    float rightGain;
+    float leftDeadband; // percent it takes to get the wheel turning
+    float rightDeadband;
+    float encoderLow; // drive encoder thresholds in volts
+    float encoderHigh;
+    float liftLow; // lift encoder thresholds in volts
+    float liftHigh;
+};
+
+// Read a profile over the top of what's there, returns false if there's no file
+bool loadCalibration(const char *name, Calibration &calibration);
+
+// Write a profile, returns false if the card couldn't be written
+bool saveCalibration(const char *name, const Calibration &calibration);
+
+#endif // CALIBRATION_H
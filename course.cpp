@@ -0,0 +1,44 @@
+#include "course.h"
+#include <cmath>
+
+const CourseWall courseWalls[] = {
+    // Outside
+    { 0, 0, COURSE_WIDTH, 0 },
+    { COURSE_WIDTH, 0, COURSE_WIDTH, COURSE_LENGTH },
+    { COURSE_WIDTH, COURSE_LENGTH, 0, COURSE_LENGTH },
+    { 0, COURSE_LENGTH, 0, 0 },
+
+    // Counter
+    { 0, 54, 14, 54 },
+    { 14, 54, 14, 72 },
+
+    // Chiller
+    { 34, 60, 48, 60 },
+    { 34, 60, 34, 72 },
+};
+
+const int numCourseWalls = sizeof(courseWalls) / sizeof(CourseWall);
+
+const CoursePose courseLight = { 14.5, 10, 90 };
+const CoursePose courseRamp = { 20, 19, 0 };
+const CoursePose courseCharger = { 36, 25, 180 };
+
+float wallClearance(float x, float y)
+{
+    float closest = 1e9;
+    for(int i = 0; i < numCourseWalls; i++)
+    {
+        const CourseWall &wall = courseWalls[i];
+        float dx = wall.x2 - wall.x1, dy = wall.y2 - wall.y1;
+
+        // Nearest point on the wall, clamped to its ends
+        float t = ((x - wall.x1) * dx + (y - wall.y1) * dy) / (dx * dx + dy * dy);
+        if(t < 0) t = 0;
+        if(t > 1) t = 1;
+
+        float ex = wall.x1 + t * dx - x, ey = wall.y1 + t * dy - y;
+        float distance = std::sqrt(ex * ex + ey * ey);
+        if(distance < closest) closest = distance;
+    }
+    return closest;
+}
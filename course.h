@@ -0,0 +1,40 @@
+#ifndef COURSE_H
+#define COURSE_H
+
+// Map of the course in RPS units: inches, heading in degrees counterclockwise
+// from the x axis. These are the numbers of the host simulator's stand-in
+// course, measure the real one before trusting them for absolute moves.
+#define COURSE_WIDTH 48.0
+#define COURSE_LENGTH 72.0
+
+// Something the robot can run into
+struct CourseWall
+{
+    float x1, y1, x2, y2;
+};
+
+// A place on the course and the way to face there
+struct CoursePose
+{
+    float x, y, heading;
+};
+
+extern const CourseWall courseWalls[];
+extern const int numCourseWalls;
+
+// Where the counter light gets read from, backed up to the bottom wall with
+// the light just ahead of the CdS cell
+extern const CoursePose courseLight;
+
+// Below the ramp facing away from the left hand wall, to back onto it and
+// line up for the ramp
+extern const CoursePose courseRamp;
+
+// In front of the charger on the right hand wall, facing away from it so we
+// can back in
+extern const CoursePose courseCharger;
+
+// Distance from a point to the nearest wall
+float wallClearance(float x, float y);
+
+#endif // COURSE_H
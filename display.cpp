@@ -0,0 +1,85 @@
+#include "display.h"
+#include <FEHLCD.h>
+#include <FEHUtility.h>
+#include <cstdio>
+#include <cstring>
+
+Display display;
+
+Display::Display()
+{
+    for(int i = 0; i < DISPLAY_ROWS; i++)
+    {
+        text[i][0] = 0;
+        dirty[i] = false;
+        drawnTime[i] = 0;
+    }
+    lastWrite = 0;
+    next = 0;
+    held = false;
+}
+
+void Display::set(int row, const char *label, float value)
+{
+    char line[DISPLAY_COLUMNS + 1];
+    snprintf(line, sizeof(line), "%-12s%10.2f", label, value);
+    set(row, line);
+}
+
+void Display::set(int row, const char *line)
+{
+    if(row < 0 || row >= DISPLAY_ROWS) return;
+
+    // Nothing to do if it's already showing
+    if(strncmp(text[row], line, DISPLAY_COLUMNS) == 0) return;
+
+    snprintf(text[row], sizeof(text[row]), "%s", line);
+    dirty[row] = true;
+}
+
+void Display::clear()
+{
+    LCD.Clear(FEHLCD::Black);
+    for(int i = 0; i < DISPLAY_ROWS; i++)
+    {
+        dirty[i] = text[i][0] != 0;
+        drawnTime[i] = 0;
+    }
+}
+
+void Display::hold(bool on)
+{
+    held = on;
+}
+
+bool Display::update()
+{
+    if(held) return false;
+
+    double now = TimeNow();
+    if(now - lastWrite < DISPLAY_WRITE_PERIOD) return false;
+
+    // Take turns so one busy row can't hog the screen
+    for(int i = 0; i < DISPLAY_ROWS; i++)
+    {
+        int row = (next + i) % DISPLAY_ROWS;
+        if(dirty[row] && now - drawnTime[row] >= DISPLAY_ROW_PERIOD)
+        {
+            draw(row);
+            drawnTime[row] = now;
+            lastWrite = now;
+            next = (row + 1) % DISPLAY_ROWS;
+            break;
+        }
+    }
+    return false;
+}
+
+void Display::draw(int row)
+{
+    // Pad with spaces so whatever was there before gets written over
+    char line[DISPLAY_COLUMNS + 1];
+    snprintf(line, sizeof(line), "%-26s", text[row]);
+    LCD.WriteRC(line, row, 0);
+    dirty[row] = false;
+}
@@ -0,0 +1,56 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "scheduler.h"
+
+// Rows the display keeps track of
+#define DISPLAY_ROWS 12
+
+// Characters across the LCD
+#define DISPLAY_COLUMNS 26
+
+// Each row is redrawn at most this often (10 Hz)
+#define DISPLAY_ROW_PERIOD .1
+
+// And the whole screen gets at most one row written this often
+#define DISPLAY_WRITE_PERIOD .02
+
+// Keeps what should be on the screen in memory. Setting a field is just a
+// store, the LCD is only written from the scheduler tick, only for rows that
+// changed, and never faster than the rates above, so writing to the screen
+// can't slow down a control loop.
+class Display : public Task
+{
+public:
+    Display();
+
+    // Show a label and a number on a row
+    void set(int row, const char *label, float value);
+
+    // Show a line of text on a row
+    void set(int row, const char *text);
+
+    // Blank the screen and draw every row again
+    void clear();
+
+    // Stop or go back to writing the LCD, for screens written straight to it
+    // while the scheduler keeps ticking
+    void hold(bool on);
+
+    // Scheduler service, writes at most one changed row per call
+    bool update();
+
+private:
+    void draw(int row);
+
+    char text[DISPLAY_ROWS][DISPLAY_COLUMNS + 1];
+    bool dirty[DISPLAY_ROWS];
+    double drawnTime[DISPLAY_ROWS];
+    double lastWrite;
+    int next;
+    bool held;
+};
+
+extern Display display;
+
+#endif // DISPLAY_H
@@ -0,0 +1,79 @@
+#include "encoders.h"
+
+EncoderSampler::EncoderSampler(TracedEncoder &encoder) : encoder(encoder)
+{
+    lastCounts = 0;
+    lastSample = 0;
+    countTime = 0;
+    filteredSpeed = 0;
+    moving = false;
+}
+
+void EncoderSampler::sample(double now)
+{
+    int counts = encoder.Counts();
+    int newCounts = counts - lastCounts;
+
+    if(newCounts > 0)
+    {
+        // The count came in some time since the last sample, call it half way
+        double arrived = (lastSample + now) / 2;
+
+        // The first count after standing still only tells us we started
+        if(moving && arrived > countTime)
+        {
+            float measured = newCounts / (arrived - countTime);
+            filteredSpeed += (measured - filteredSpeed) * ENCODER_SPEED_FILTER;
+        }
+
+        moving = true;
+        countTime = arrived;
+        lastCounts = counts;
+    }
+    else if(newCounts < 0)
+    {
+        // Someone reset the encoder behind our back, start over
+        lastCounts = counts;
+        countTime = now;
+        filteredSpeed = 0;
+        moving = false;
+    }
+    else if(moving)
+    {
+        // No count yet, so we can't be going faster than one count in the
+        // time since the last one
+        double waited = now - countTime;
+        if(waited > 0 && filteredSpeed > 1 / waited) filteredSpeed = 1 / waited;
+
+        // Long enough without a count and we've stopped (the speed itself is
+        // still 0 until the second count, so it can't tell us that)
+        if(waited > 1 / ENCODER_MIN_SPEED)
+        {
+            filteredSpeed = 0;
+            moving = false;
+        }
+    }
+
+    lastSample = now;
+}
+
+void EncoderSampler::reset()
+{
+    encoder.ResetCounts();
+    lastCounts = 0;
+}
+
+float EncoderSampler::position(double now) const
+{
+    return predict(now, 0);
+}
+
+float EncoderSampler::predict(double now, float ahead) const
+{
+    float extra = filteredSpeed * (now + ahead - countTime);
+
+    // Never claim the next count before it shows up (unless asked to look ahead)
+    if(ahead <= 0 && extra > .99) extra = .99;
+    if(extra < 0) extra = 0;
+    return lastCounts + extra;
+}
@@ -0,0 +1,51 @@
+#ifndef ENCODERS_H
+#define ENCODERS_H
+
+#include "trace.h"
+
+// How quickly the speed estimate follows a new measurement (0..1)
+#define ENCODER_SPEED_FILTER 0.5
+
+// Slower than this and we call the shaft stopped (counts per second)
+#define ENCODER_MIN_SPEED 1.0
+
+// Watches one shaft encoder. It is sampled once per tick, works out when each
+// count came in, and from the time between counts gives a filtered speed and
+// a position in between counts. Encoders only count up, so speeds are
+// magnitudes and the motor command gives the direction.
+class EncoderSampler
+{
+public:
+    EncoderSampler(TracedEncoder &encoder);
+
+    // Read the encoder (once per tick)
+    void sample(double now);
+
+    // Zero the encoder, go through here so the history stays right
+    void reset();
+
+    // Whole counts at the last sample
+    int counts() const { return lastCounts; }
+
+    // Filtered speed in counts per second
+    float speed() const { return filteredSpeed; }
+
+    // Counts including how far we are toward the next one
+    float position(double now) const;
+
+    // Where we will be a little while from now at the current speed
+    float predict(double now, float ahead) const;
+
+    // When the last count came in
+    double lastCountTime() const { return countTime; }
+
+private:
+    TracedEncoder &encoder;
+    int lastCounts;
+    double lastSample;
+    double countTime;
+    float filteredSpeed;
+    bool moving;
+};
+
+#endif // ENCODERS_H
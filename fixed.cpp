@@ -0,0 +1,53 @@
+#include "fixed.h"
+
+FixedPID::FixedPID(float kp, float ki, float kd, float outMin, float outMax)
+{
+    this->kp = fixedFromFloat(kp);
+    this->ki = fixedFromFloat(ki);
+    this->kd = fixedFromFloat(kd);
+    this->outMin = fixedFromFloat(outMin);
+    this->outMax = fixedFromFloat(outMax);
+    reset();
+}
+
+void FixedPID::reset()
+{
+    integral = 0;
+    lastError = 0;
+    first = true;
+}
+
+fixed FixedPID::step(fixed error, fixed dt)
+{
+    if(dt <= 0) dt = FIXED(0.001);
+
+    // No derivative kick on the first sample, and no divide when there's no kd
+    fixed derivative = first || kd == 0 ? 0 : fixedDiv(fixedSub(error, lastError), dt);
+    first = false;
+    lastError = error;
+
+    fixed output = fixedAdd(fixedMul(kp, error), fixedMul(kd, derivative));
+
+    // Only integrate while the output isn't pinned against a limit
+    fixed newIntegral = fixedAdd(integral, fixedMul(error, dt));
+    fixed withIntegral = fixedAdd(output, fixedMul(ki, newIntegral));
+    if(withIntegral > outMax) return outMax;
+    if(withIntegral < outMin) return outMin;
+
+    integral = newIntegral;
+    return withIntegral;
+}
+
+FixedOdometry::FixedOdometry(float inchesPerCount, float wheelBase)
+{
+    halfPerCount = fixedFromFloat(inchesPerCount / 2);
+    turnPerCount = fixedFromFloat(inchesPerCount / wheelBase);
+    reset();
+}
+
+void FixedOdometry::add(int leftCounts, int rightCounts)
+{
+    // Half the sum of the wheels for the middle, the difference over the base for the turn
+    distance = fixedAdd(distance, fixedScale(leftCounts + rightCounts, halfPerCount));
+    turn = fixedAdd(turn, fixedScale(rightCounts - leftCounts, turnPerCount));
+}
@@ -0,0 +1,152 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+// Fixed point math for the control loop, for controllers where float is slow.
+// A fixed is a 32 bit integer with FIXED_FRACTION_BITS after the binary
+// point. 16 (Q16.16) steps by 1/65536 up to 32767, plenty for counts, inches,
+// percents and seconds. Build with -DFIXED_FRACTION_BITS=n for another split.
+#ifndef FIXED_FRACTION_BITS
+#define FIXED_FRACTION_BITS 16
+#endif
+
+typedef int32_t fixed;
+
+#define FIXED_ONE ((fixed)1 << FIXED_FRACTION_BITS)
+#define FIXED_MAX ((fixed)0x7fffffff)
+#define FIXED_MIN (-FIXED_MAX - 1)
+
+// A constant in fixed point, rounded to the nearest step. Made for the
+// #define settings, the compiler works it out so nothing is left to do at
+// run time: FIXED(WHEEL_KP)
+#define FIXED(x) ((fixed)((x) * (double)FIXED_ONE + ((x) < 0 ? -.5 : .5)))
+
+// Anything past the ends is pinned to them rather than wrapping around
+inline fixed fixedSaturate(int64_t value)
+{
+    if(value > FIXED_MAX) return FIXED_MAX;
+    if(value < FIXED_MIN) return FIXED_MIN;
+    return (fixed)value;
+}
+
+inline fixed fixedFromFloat(float value)
+{
+    float scaled = value * FIXED_ONE;
+    if(scaled >= 2147483647.0f) return FIXED_MAX;
+    if(scaled <= -2147483648.0f) return FIXED_MIN;
+    return (fixed)(scaled < 0 ? scaled - .5f : scaled + .5f);
+}
+
+inline float fixedToFloat(fixed value)
+{
+    return value * (1.0f / FIXED_ONE);
+}
+
+inline fixed fixedFromInt(int value)
+{
+    return fixedSaturate((int64_t)value << FIXED_FRACTION_BITS);
+}
+
+inline fixed fixedAdd(fixed a, fixed b)
+{
+    return fixedSaturate((int64_t)a + b);
+}
+
+inline fixed fixedSub(fixed a, fixed b)
+{
+    return fixedSaturate((int64_t)a - b);
+}
+
+// Rounded to the nearest step
+inline fixed fixedMul(fixed a, fixed b)
+{
+    int64_t product = (int64_t)a * b;
+    return fixedSaturate((product + ((int64_t)1 << (FIXED_FRACTION_BITS - 1))) >> FIXED_FRACTION_BITS);
+}
+
+// A whole number of something times a fixed, no shift needed
+inline fixed fixedScale(int n, fixed a)
+{
+    return fixedSaturate((int64_t)n * a);
+}
+
+// Dividing by 0 gives the end the answer was heading for
+inline fixed fixedDiv(fixed a, fixed b)
+{
+    if(b == 0) return a < 0 ? FIXED_MIN : FIXED_MAX;
+    return fixedSaturate(((int64_t)a << FIXED_FRACTION_BITS) / b);
+}
+
+// The PID controller in pid.h worked in fixed point. The gains and limits go
+// in once as floats, the work every tick is integer only. update() takes and
+// gives floats so it can stand in for PID, but converting both ways every
+// call costs what the integer math saves. step() is the same in fixed, for a
+// loop that keeps its values in fixed.
+class FixedPID
+{
+public:
+    FixedPID(float kp, float ki, float kd, float outMin, float outMax);
+
+    // Forget the integral and last error (call before each new move)
+    void reset();
+
+    // Feed the error for this tick and get the controller output
+    float update(float error, float dt) { return fixedToFloat(step(fixedFromFloat(error), fixedFromFloat(dt))); }
+    fixed step(fixed error, fixed dt);
+
+private:
+    fixed kp, ki, kd;
+    fixed outMin, outMax;
+    fixed integral;
+    fixed lastError;
+    bool first;
+};
+
+// First order low pass, every sample moves the value a set share of the way
+// to it (like the encoder speed filter). Only host/robot-bench uses it so far.
+class FixedFilter
+{
+public:
+    FixedFilter(float share) : share(fixedFromFloat(share)), value(0) {}
+
+    void reset(fixed value = 0) { this->value = value; }
+
+    fixed update(fixed sample)
+    {
+        value = fixedAdd(value, fixedMul(fixedSub(sample, value), share));
+        return value;
+    }
+
+    fixed get() const { return value; }
+
+private:
+    fixed share;
+    fixed value;
+};
+
+// Dead reckoning from encoder counts in fixed point: how far the middle of
+// the robot went and how far it turned. No trig, that's left to whoever
+// turns it into a position. Only host/robot-bench uses it so far.
+class FixedOdometry
+{
+public:
+    FixedOdometry(float inchesPerCount, float wheelBase);
+
+    // Give it the counts each wheel turned since the last call, signed by the
+    // way it went
+    void add(int leftCounts, int rightCounts);
+
+    void reset() { distance = turn = 0; }
+
+    fixed travelled() const { return distance; } // inches
+    fixed turned() const { return turn; } // radians, counterclockwise
+
+private:
+    fixed halfPerCount; // inches the middle goes for one count of one wheel
+    fixed turnPerCount; // radians for one count of one wheel against the other
+    fixed distance;
+    fixed turn;
+};
+
+#endif // FIXED_H
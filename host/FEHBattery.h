@@ -0,0 +1,13 @@
+#ifndef FEHBATTERY_H
+#define FEHBATTERY_H
+
+// Host stand-in for the battery monitor, reads the simulated pack
+class FEHBattery
+{
+public:
+    float Voltage();
+};
+
+extern FEHBattery Battery;
+
+#endif // FEHBATTERY_H
@@ -0,0 +1,43 @@
+#ifndef FEHLCD_H
+#define FEHLCD_H
+
+// Host stand-in for the FEH LCD. Text goes to stdout when the simulator is
+// run with -v, and every write costs about as much time as the real screen.
+class FEHLCD
+{
+public:
+    enum FEHLCDColor
+    {
+        Black,
+        White,
+        Red,
+        Green,
+        Blue,
+        Scarlet,
+        Gray
+    };
+
+    void Clear(FEHLCDColor color);
+    void Clear();
+    void SetFontColor(FEHLCDColor color);
+    void SetBackgroundColor(FEHLCDColor color);
+
+    void Write(const char *str);
+    void Write(int i);
+    void Write(float f);
+    void Write(double d);
+
+    void WriteLine(const char *str);
+    void WriteLine(int i);
+    void WriteLine(float f);
+    void WriteLine(double d);
+
+    void WriteRC(const char *str, int row, int col);
+    void WriteRC(int i, int row, int col);
+    void WriteRC(float f, int row, int col);
+    void WriteRC(double d, int row, int col);
+};
+
+extern FEHLCD LCD;
+
+#endif // FEHLCD_H
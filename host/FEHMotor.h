@@ -0,0 +1,24 @@
+#ifndef FEHMOTOR_H
+#define FEHMOTOR_H
+
+// Host stand-in for a motor port, commands go to the simulated robot
+class FEHMotor
+{
+public:
+    enum FEHMotorPort
+    {
+        Motor0,
+        Motor1,
+        Motor2,
+        Motor3
+    };
+
+    FEHMotor(FEHMotorPort port);
+    void SetPercent(float percent);
+    void Stop();
+
+private:
+    FEHMotorPort port;
+};
+
+#endif // FEHMOTOR_H
@@ -0,0 +1,24 @@
+#ifndef FEHSD_H
+#define FEHSD_H
+
+#include <cstdio>
+
+// Host stand-in for the SD card, files go in the current directory
+struct FEHFile
+{
+    FILE *file;
+};
+
+class FEHSD
+{
+public:
+    FEHFile *FOpen(const char *name, const char *mode);
+    int FClose(FEHFile *file);
+    int FPrintf(FEHFile *file, const char *format, ...);
+    int FScanf(FEHFile *file, const char *format, ...);
+    int FEof(FEHFile *file);
+};
+
+extern FEHSD SD;
+
+#endif // FEHSD_H
@@ -0,0 +1,15 @@
+#ifndef FEHUTILITY_H
+#define FEHUTILITY_H
+
+// Host stand-in for the FEH utilities, on the simulator's virtual clock
+
+void Sleep(int msec);
+void Sleep(float sec);
+void Sleep(double sec);
+
+double TimeNow();
+unsigned int TimeNowSec();
+unsigned int TimeNowMSec();
+void ResetTime();
+
+#endif // FEHUTILITY_H
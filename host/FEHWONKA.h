@@ -0,0 +1,22 @@
+#ifndef FEHWONKA_H
+#define FEHWONKA_H
+
+// Host stand-in for the RPS receiver. Position is in inches and heading in
+// degrees counterclockwise from the x axis, refreshed a few times a second.
+class FEHWONKA
+{
+public:
+    void InitializeMenu();
+    void Enable();
+    void Disable();
+
+    float X();
+    float Y();
+    float Heading();
+
+    int Oven();
+    int Chiller();
+    int WaitForPacket();
+};
+
+#endif // FEHWONKA_H
@@ -0,0 +1,174 @@
+// Times the control loop math in float against the fixed point kernels in
+// fixed.h, and checks they agree
+//
+//   robot-bench [-n calls]
+//
+// The host has a floating point unit, so this mostly shows what the fixed
+// point costs per call and how far it strays from float. Build it for the
+// robot's controller to see what it saves there.
+
+#include "../pid.h"
+#include "../fixed.h"
+#include "../wheels.h"
+#include "../encoders.h"
+#include "../scheduler.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+// The robot's before it is calibrated, the way main.cpp works them out
+#define INCHES_PER_COUNT ((WHEEL_CIRCUMFERENCE) / COUNTS_PER_WHEEL)
+#define WHEEL_BASE (4 * COUNTS_TO_PIVOT * INCHES_PER_COUNT / 3.14159)
+
+#define BENCH_CALLS 10000000
+#define BENCH_INPUTS 1024 // inputs cycled through so nothing gets worked out ahead
+
+// One scheduler tick
+#define BENCH_DT TICK_PERIOD
+
+static float errors[BENCH_INPUTS];
+static fixed fixedErrors[BENCH_INPUTS];
+static int leftCounts[BENCH_INPUTS], rightCounts[BENCH_INPUTS];
+
+// Kept so the compiler can't drop the work
+static volatile float floatSink;
+static volatile fixed fixedSink;
+
+static double seconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void report(const char *kernel, double floatTime, double fixedTime, int calls, double difference, const char *units)
+{
+    printf("%-10s float %6.2f ns  fixed %6.2f ns  %5.2fx  most apart %.5f %s\n", kernel, floatTime * 1e9 / calls,
+           fixedTime * 1e9 / calls, fixedTime > 0 ? floatTime / fixedTime : 0, difference, units);
+}
+
+static void benchPID(int calls)
+{
+    PID floatPID(WHEEL_KP, WHEEL_KI, WHEEL_KD, -WHEEL_CORRECTION_MAX, WHEEL_CORRECTION_MAX);
+    FixedPID fixedPID(WHEEL_KP, WHEEL_KI, WHEEL_KD, -WHEEL_CORRECTION_MAX, WHEEL_CORRECTION_MAX);
+
+    clock_t start = clock();
+    float total = 0;
+    for(int i = 0; i < calls; i++) total += floatPID.update(errors[i % BENCH_INPUTS], BENCH_DT);
+    floatSink = total;
+    double floatTime = seconds(start);
+
+    start = clock();
+    fixed fixedTotal = 0;
+    fixed dt = FIXED(BENCH_DT);
+    for(int i = 0; i < calls; i++) fixedTotal += fixedPID.step(fixedErrors[i % BENCH_INPUTS], dt);
+    fixedSink = fixedTotal;
+    double fixedTime = seconds(start);
+
+    // Run them side by side for the difference
+    floatPID.reset();
+    fixedPID.reset();
+    double apart = 0;
+    for(int i = 0; i < BENCH_INPUTS * 16; i++)
+    {
+        float a = floatPID.update(errors[i % BENCH_INPUTS], BENCH_DT);
+        float b = fixedToFloat(fixedPID.step(fixedErrors[i % BENCH_INPUTS], dt));
+        if(std::fabs(a - b) > apart) apart = std::fabs(a - b);
+    }
+
+    report("PID", floatTime, fixedTime, calls, apart, "percent");
+}
+
+static void benchFilter(int calls)
+{
+    float value = 0;
+    clock_t start = clock();
+    for(int i = 0; i < calls; i++) value += (errors[i % BENCH_INPUTS] - value) * (float)ENCODER_SPEED_FILTER;
+    floatSink = value;
+    double floatTime = seconds(start);
+
+    FixedFilter filter(ENCODER_SPEED_FILTER);
+    start = clock();
+    for(int i = 0; i < calls; i++) filter.update(fixedErrors[i % BENCH_INPUTS]);
+    fixedSink = filter.get();
+    double fixedTime = seconds(start);
+
+    value = 0;
+    filter.reset();
+    double apart = 0;
+    for(int i = 0; i < BENCH_INPUTS * 16; i++)
+    {
+        value += (errors[i % BENCH_INPUTS] - value) * (float)ENCODER_SPEED_FILTER;
+        float b = fixedToFloat(filter.update(fixedErrors[i % BENCH_INPUTS]));
+        if(std::fabs(value - b) > apart) apart = std::fabs(value - b);
+    }
+
+    report("Filter", floatTime, fixedTime, calls, apart, "counts/s");
+}
+
+static void benchOdometry(int calls)
+{
+    float distance = 0, turn = 0;
+    clock_t start = clock();
+    for(int i = 0; i < calls; i++)
+    {
+        int left = leftCounts[i % BENCH_INPUTS], right = rightCounts[i % BENCH_INPUTS];
+        distance += (left + right) * (float)INCHES_PER_COUNT / 2;
+        turn += (right - left) * (float)INCHES_PER_COUNT / (float)WHEEL_BASE;
+    }
+    floatSink = distance + turn;
+    double floatTime = seconds(start);
+
+    FixedOdometry odometry(INCHES_PER_COUNT, WHEEL_BASE);
+    start = clock();
+    for(int i = 0; i < calls; i++) odometry.add(leftCounts[i % BENCH_INPUTS], rightCounts[i % BENCH_INPUTS]);
+    fixedSink = odometry.travelled() + odometry.turned();
+    double fixedTime = seconds(start);
+
+    // Against double, over that many calls float's own rounding adds up too
+    double exact = 0;
+    odometry.reset();
+    double apart = 0;
+    for(int i = 0; i < BENCH_INPUTS * 16; i++)
+    {
+        int left = leftCounts[i % BENCH_INPUTS], right = rightCounts[i % BENCH_INPUTS];
+        exact += (left + right) * INCHES_PER_COUNT / 2;
+        odometry.add(left, right);
+        double off = std::fabs(exact - fixedToFloat(odometry.travelled()));
+        if(off > apart) apart = off;
+    }
+
+    report("Odometry", floatTime, fixedTime, calls, apart, "inches");
+}
+
+int main(int argc, char **argv)
+{
+    int calls = BENCH_CALLS;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) calls = atoi(argv[++i]);
+        else
+        {
+            printf("usage: robot-bench [-n calls]\n");
+            return 2;
+        }
+    }
+    if(calls < 1) calls = 1;
+
+    // Wheel speed errors in counts per second and a tick's worth of counts,
+    // the sort of thing the loop sees
+    srand(1);
+    for(int i = 0; i < BENCH_INPUTS; i++)
+    {
+        errors[i] = (rand() % 8000 - 4000) / 100.0f;
+        fixedErrors[i] = fixedFromFloat(errors[i]);
+        leftCounts[i] = rand() % 3;
+        rightCounts[i] = rand() % 3 - (rand() % 4 == 0 ? 2 : 0);
+    }
+
+    printf("%d calls each, Q%d.%d\n", calls, 31 - FIXED_FRACTION_BITS, FIXED_FRACTION_BITS);
+    benchPID(calls);
+    benchFilter(calls);
+    benchOdometry(calls);
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Turns a telemetry dump from the SD card into CSV
+//
+//   telemetry-decode TELEM.TXT > run.csv
+//   gnuplot -e "file='run.csv'" telemetry.gp
+
+#include "../telemetry.h"
+#include <cstdio>
+#include <cstring>
+
+static int hexDigit(char c)
+{
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc != 2)
+    {
+        fprintf(stderr, "usage: telemetry-decode dump\n");
+        return 2;
+    }
+
+    FILE *file = fopen(argv[1], "r");
+    if(!file)
+    {
+        fprintf(stderr, "telemetry-decode: can't open %s\n", argv[1]);
+        return 1;
+    }
+
+    // Make sure the robot and this decoder agree on the record
+    char line[256];
+    int size = 0, count = 0;
+    if(!fgets(line, sizeof(line), file) || strncmp(line, TELEMETRY_HEADER, strlen(TELEMETRY_HEADER)) != 0 ||
+       sscanf(line + strlen(TELEMETRY_HEADER), "%d %d", &size, &count) != 2 || size != (int)sizeof(TelemetryRecord))
+    {
+        fprintf(stderr, "telemetry-decode: %s is not a telemetry dump this decoder understands\n", argv[1]);
+        fclose(file);
+        return 1;
+    }
+
+    printf("time,left_counts,right_counts,lift_counts,cds,rps_x,rps_y,rps_heading,"
+           "left_percent,right_percent,lift_percent,back_left,back_right,lift_bottom,segment,step,battery,scale\n");
+
+    int decoded = 0;
+    while(fgets(line, sizeof(line), file))
+    {
+        TelemetryRecord record;
+        unsigned char *bytes = (unsigned char *)&record;
+        bool good = true;
+        for(unsigned int i = 0; i < sizeof(record) && good; i++)
+        {
+            int high = hexDigit(line[2 * i]), low = hexDigit(line[2 * i + 1]);
+            if(high < 0 || low < 0) good = false;
+            else bytes[i] = high * 16 + low;
+        }
+        if(!good)
+        {
+            fprintf(stderr, "telemetry-decode: skipping bad line %d\n", decoded + 2);
+            continue;
+        }
+
+        printf("%.3f,%u,%u,%u,%.3f,%.1f,%.1f,%.1f,%d,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f\n",
+               record.time / 1000.0,
+               record.leftCounts, record.rightCounts, record.liftCounts,
+               record.cds / 1000.0,
+               record.rpsX / 10.0, record.rpsY / 10.0, record.rpsHeading / 10.0,
+               record.leftPercent, record.rightPercent, record.liftPercent,
+               (record.switches & TELEMETRY_BACK_LEFT) != 0,
+               (record.switches & TELEMETRY_BACK_RIGHT) != 0,
+               (record.switches & TELEMETRY_LIFT_BOTTOM) != 0,
+               record.segment == 255 ? -1 : record.segment + 1,
+               record.step == 255 ? -1 : record.step + 1,
+               record.battery / 1000.0, record.scale / 1000.0);
+        decoded++;
+    }
+    fclose(file);
+
+    if(decoded != count) fprintf(stderr, "telemetry-decode: expected %d records, got %d\n", count, decoded);
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Stand-in FEH library calls, each one forwards to the simulator
+
+#include "FEHLCD.h"
+#include "FEHIO.h"
+#include "FEHUtility.h"
+#include "FEHWONKA.h"
+#include "FEHMotor.h"
+#include "FEHSD.h"
+#include "FEHBattery.h"
+#include "sim.h"
+#include <cstdio>
+#include <cstdarg>
+
+FEHLCD LCD;
+
+// ***************************LCD**************************
+
+static void lcdText(const char *text, bool newline)
+{
+    simAdvance(SIM_LCD_CALL);
+    if(simConfig.verbose) printf(newline ? "%s\n" : "%s", text);
+}
+
+static void lcdNumber(double number, bool newline)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%g", number);
+    lcdText(text, newline);
+}
+
+void FEHLCD::Clear(FEHLCDColor) { simAdvance(SIM_LCD_CALL); }
+void FEHLCD::Clear() { simAdvance(SIM_LCD_CALL); }
+void FEHLCD::SetFontColor(FEHLCDColor) {}
+void FEHLCD::SetBackgroundColor(FEHLCDColor) {}
+
+void FEHLCD::Write(const char *str) { lcdText(str, false); }
+void FEHLCD::Write(int i) { lcdNumber(i, false); }
+void FEHLCD::Write(float f) { lcdNumber(f, false); }
+void FEHLCD::Write(double d) { lcdNumber(d, false); }
+
+void FEHLCD::WriteLine(const char *str) { lcdText(str, true); }
+void FEHLCD::WriteLine(int i) { lcdNumber(i, true); }
+void FEHLCD::WriteLine(float f) { lcdNumber(f, true); }
+void FEHLCD::WriteLine(double d) { lcdNumber(d, true); }
+
+void FEHLCD::WriteRC(const char *str, int, int) { lcdText(str, true); }
+void FEHLCD::WriteRC(int i, int, int) { lcdNumber(i, true); }
+void FEHLCD::WriteRC(float f, int, int) { lcdNumber(f, true); }
+void FEHLCD::WriteRC(double d, int, int) { lcdNumber(d, true); }
+
+// ***************************IO***************************
+
+AnalogInputPin::AnalogInputPin(FEHIO::FEHIOPin pin) : pin(pin) {}
+float AnalogInputPin::Value() { return simAnalog(pin); }
+
+DigitalInputPin::DigitalInputPin(FEHIO::FEHIOPin pin) : pin(pin) {}
+int DigitalInputPin::Value() { return simDigital(pin); }
+
+FEHEncoder::FEHEncoder(FEHIO::FEHIOPin pin) : pin(pin) {}
+void FEHEncoder::SetThresholds(float, float) {}
+int FEHEncoder::Counts() { return simEncoderCounts(pin); }
+void FEHEncoder::ResetCounts() { simEncoderReset(pin); }
+
+ButtonBoard::ButtonBoard(FEHIO::FEHIOPort) {}
+int ButtonBoard::LeftPressed() { return simButton(0); }
+int ButtonBoard::MiddlePressed() { return simButton(1); }
+int ButtonBoard::RightPressed() { return simButton(2); }
+int ButtonBoard::LeftReleased() { return !simButton(0); }
+int ButtonBoard::MiddleReleased() { return !simButton(1); }
+int ButtonBoard::RightReleased() { return !simButton(2); }
+
+// ***************************UTILITY**********************
+
+void Sleep(int msec) { simAdvance(msec / 1000.0); }
+void Sleep(float sec) { simAdvance(sec); }
+void Sleep(double sec) { simAdvance(sec); }
+
+double TimeNow()
+{
+    simAdvance(SIM_TIME_CALL);
+    return simTime();
+}
+
+unsigned int TimeNowSec() { return (unsigned int)TimeNow(); }
+unsigned int TimeNowMSec() { return (unsigned int)(TimeNow() * 1000); }
+void ResetTime() {}
+
+// ***************************RPS**************************
+
+void FEHWONKA::InitializeMenu() {}
+void FEHWONKA::Enable() {}
+void FEHWONKA::Disable() {}
+
+float FEHWONKA::X()
+{
+    float x, y, heading;
+    simRPS(x, y, heading);
+    return x;
+}
+
+float FEHWONKA::Y()
+{
+    float x, y, heading;
+    simRPS(x, y, heading);
+    return y;
+}
+
+float FEHWONKA::Heading()
+{
+    float x, y, heading;
+    simRPS(x, y, heading);
+    return heading;
+}
+
+int FEHWONKA::Oven() { return simOven(); }
+int FEHWONKA::Chiller() { return 0; }
+int FEHWONKA::WaitForPacket() { simAdvance(0.1); return 1; }
+
+// ***************************MOTOR************************
+
+FEHMotor::FEHMotor(FEHMotorPort port) : port(port) {}
+void FEHMotor::SetPercent(float percent) { simMotor(port, percent); }
+void FEHMotor::Stop() { simMotor(port, 0); }
+
+// ***************************BATTERY**********************
+
+FEHBattery Battery;
+
+float FEHBattery::Voltage() { return simBattery(); }
+
+// ***************************SD***************************
+
+FEHSD SD;
+
+FEHFile *FEHSD::FOpen(const char *name, const char *mode)
+{
+    FILE *file = fopen(name, mode);
+    if(!file) return 0;
+
+    FEHFile *result = new FEHFile;
+    result->file = file;
+    return result;
+}
+
+int FEHSD::FClose(FEHFile *file)
+{
+    int result = fclose(file->file);
+    delete file;
+    return result;
+}
+
+int FEHSD::FPrintf(FEHFile *file, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int result = vfprintf(file->file, format, args);
+    va_end(args);
+    return result;
+}
+
+int FEHSD::FScanf(FEHFile *file, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int result = vfscanf(file->file, format, args);
+    va_end(args);
+    return result;
+}
+
+int FEHSD::FEof(FEHFile *file)
+{
+    return feof(file->file);
+}
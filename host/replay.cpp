@@ -0,0 +1,332 @@
+// Plays a sensor trace recorded on the robot back through the robot program
+// and checks its motor commands against the ones the robot gave
+//
+//   robot-replay [-v] [-w seconds] [-t percent] run.txt
+//
+// Stands in for the simulator: instead of a physics model every read returns
+// what the robot read at that time. The clock is the same virtual one, so a
+// replay is repeatable and takes milliseconds.
+
+#include "sim.h"
+#include "../trace.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <vector>
+#include <algorithm>
+
+// The robot's own main, renamed when it is built for the host
+int robot_main();
+
+SimConfig simConfig = { 0, 0, 0, 0, 0, 1, 0, 0 };
+
+// Commands this close together in time count as the same command
+#define REPLAY_WINDOW 0.05
+
+// Motor commands this close count as the same
+#define REPLAY_TOLERANCE 2.0
+
+// Keep the program going this long past the end of the trace
+#define REPLAY_TAIL 1.0
+
+// Differences printed, the rest are only counted
+#define REPLAY_SHOWN 10
+
+struct Sample
+{
+    double time;
+    float value;
+};
+
+typedef std::vector<Sample> Series;
+
+// What the robot read and did, and what the program did on replay
+static Series recorded[TRACE_SOURCES][TRACE_CHANNELS];
+static Series replayed[TRACE_SOURCES][TRACE_CHANNELS];
+
+static double now;
+static double endTime;
+static double window = REPLAY_WINDOW;
+static double tolerance = REPLAY_TOLERANCE;
+
+static int hexDigit(char c)
+{
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool load(const char *name)
+{
+    FILE *file = fopen(name, "r");
+    if(!file)
+    {
+        fprintf(stderr, "robot-replay: can't open %s\n", name);
+        return false;
+    }
+
+    // Make sure the robot and the replay agree on the record
+    char line[256];
+    int size = 0, count = 0;
+    if(!fgets(line, sizeof(line), file) || strncmp(line, TRACE_HEADER, strlen(TRACE_HEADER)) != 0 ||
+       sscanf(line + strlen(TRACE_HEADER), "%d %d", &size, &count) != 2 || size != (int)sizeof(TraceRecord))
+    {
+        fprintf(stderr, "robot-replay: %s is not a trace this replay understands\n", name);
+        fclose(file);
+        return false;
+    }
+
+    while(fgets(line, sizeof(line), file))
+    {
+        TraceRecord record;
+        unsigned char *bytes = (unsigned char *)&record;
+        bool good = true;
+        for(unsigned int i = 0; i < sizeof(record) && good; i++)
+        {
+            int high = hexDigit(line[2 * i]), low = hexDigit(line[2 * i + 1]);
+            if(high < 0 || low < 0) good = false;
+            else bytes[i] = high * 16 + low;
+        }
+        if(!good || record.source >= TRACE_SOURCES || record.channel >= TRACE_CHANNELS)
+        {
+            fprintf(stderr, "robot-replay: skipping bad line %s", line);
+            continue;
+        }
+
+        Sample sample = { record.time / 1000000.0, record.value / traceScale(record.source, record.channel) };
+        recorded[record.source][record.channel].push_back(sample);
+        endTime = std::max(endTime, sample.time);
+    }
+
+    fclose(file);
+    return true;
+}
+
+// The value at a time, before the first sample it's the first sample
+static float valueAt(const Series &series, double time, float fallback)
+{
+    if(series.empty()) return fallback;
+
+    // Last sample at or before the time
+    unsigned int low = 0, high = series.size();
+    while(low < high)
+    {
+        unsigned int middle = (low + high) / 2;
+        if(series[middle].time <= time) low = middle + 1;
+        else high = middle;
+    }
+    return series[low > 0 ? low - 1 : 0].value;
+}
+
+// ***************************CLOCK************************
+
+void simAdvance(double seconds)
+{
+    now += seconds;
+    if(now > endTime + REPLAY_TAIL) simFinish();
+}
+
+double simTime()
+{
+    return now;
+}
+
+// ***************************HARDWARE*********************
+
+void simMotor(int port, float percent)
+{
+    if(port < 0 || port >= TRACE_CHANNELS) return;
+
+    // Kept the way the robot records them, only when they change
+    Series &series = replayed[TRACE_MOTOR][port];
+    int16_t value = traceValue(TRACE_MOTOR, port, percent);
+    float scale = traceScale(TRACE_MOTOR, port);
+    if(series.empty() || traceChanged(TRACE_MOTOR, traceValue(TRACE_MOTOR, port, series.back().value), value))
+    {
+        Sample sample = { now, value / scale };
+        series.push_back(sample);
+    }
+}
+
+int simEncoderCounts(int pin)
+{
+    simAdvance(SIM_READ_CALL);
+    return (int)valueAt(recorded[TRACE_COUNTS][pin], now, 0);
+}
+
+void simEncoderReset(int pin)
+{
+    Sample sample = { now, 0 };
+    replayed[TRACE_RESET][pin].push_back(sample);
+}
+
+float simAnalog(int pin)
+{
+    simAdvance(SIM_READ_CALL);
+    return valueAt(recorded[TRACE_ANALOG][pin], now, 0);
+}
+
+int simDigital(int pin)
+{
+    simAdvance(SIM_READ_CALL);
+    return (int)valueAt(recorded[TRACE_DIGITAL][pin], now, 1);
+}
+
+int simButton(int button)
+{
+    simAdvance(SIM_READ_CALL);
+    return (int)valueAt(recorded[TRACE_BUTTON][button], now, 0);
+}
+
+void simRPS(float &x, float &y, float &heading)
+{
+    simAdvance(SIM_READ_CALL);
+    x = valueAt(recorded[TRACE_RPS][TRACE_RPS_X], now, -1);
+    y = valueAt(recorded[TRACE_RPS][TRACE_RPS_Y], now, -1);
+    heading = valueAt(recorded[TRACE_RPS][TRACE_RPS_HEADING], now, -1);
+}
+
+int simOven()
+{
+    return (int)valueAt(recorded[TRACE_RPS][TRACE_RPS_OVEN], now, 1);
+}
+
+float simBattery()
+{
+    simAdvance(SIM_READ_CALL);
+    return valueAt(recorded[TRACE_BATTERY][0], now, 0);
+}
+
+// ***************************COMPARE**********************
+
+struct Difference
+{
+    double time;
+    char text[96];
+};
+
+static std::vector<Difference> differences;
+
+static bool earlier(const Difference &a, const Difference &b)
+{
+    return a.time < b.time;
+}
+
+// Did a motor sit at this value at some point around this time
+static bool commanded(const Series &series, double time, float value)
+{
+    if(std::fabs(valueAt(series, time - window, 0) - value) <= tolerance) return true;
+    for(unsigned int i = 0; i < series.size(); i++)
+    {
+        if(series[i].time > time - window && series[i].time <= time + window &&
+           std::fabs(series[i].value - value) <= tolerance) return true;
+    }
+    return false;
+}
+
+// Was there an event around this time
+static bool happened(const Series &series, double time)
+{
+    for(unsigned int i = 0; i < series.size(); i++)
+    {
+        if(std::fabs(series[i].time - time) <= window) return true;
+    }
+    return false;
+}
+
+static void compareMotor(int port, const Series &from, const Series &against, const char *by, const char *other)
+{
+    for(unsigned int i = 0; i < from.size(); i++)
+    {
+        // Nothing to go on past the end of the trace
+        if(from[i].time > endTime) break;
+        if(commanded(against, from[i].time, from[i].value)) continue;
+
+        Difference difference;
+        difference.time = from[i].time;
+        snprintf(difference.text, sizeof(difference.text), "motor %d: %s %.2f, %s %.2f", port, by, from[i].value, other,
+                 valueAt(against, from[i].time, 0));
+        differences.push_back(difference);
+    }
+}
+
+static void compareResets(int pin, const Series &from, const Series &against, const char *by)
+{
+    for(unsigned int i = 0; i < from.size(); i++)
+    {
+        if(from[i].time > endTime) break;
+        if(happened(against, from[i].time)) continue;
+
+        Difference difference;
+        difference.time = from[i].time;
+        snprintf(difference.text, sizeof(difference.text), "encoder on pin %d reset by the %s only", pin, by);
+        differences.push_back(difference);
+    }
+}
+
+// ***************************RUN**************************
+
+void simReset()
+{
+    now = 0;
+}
+
+void simFinish()
+{
+    for(int channel = 0; channel < TRACE_CHANNELS; channel++)
+    {
+        compareMotor(channel, replayed[TRACE_MOTOR][channel], recorded[TRACE_MOTOR][channel], "replay", "robot");
+        compareMotor(channel, recorded[TRACE_MOTOR][channel], replayed[TRACE_MOTOR][channel], "robot", "replay");
+        compareResets(channel, replayed[TRACE_RESET][channel], recorded[TRACE_RESET][channel], "replay");
+        compareResets(channel, recorded[TRACE_RESET][channel], replayed[TRACE_RESET][channel], "robot");
+    }
+    std::stable_sort(differences.begin(), differences.end(), earlier);
+
+    for(unsigned int i = 0; i < differences.size() && i < REPLAY_SHOWN; i++)
+    {
+        printf("%8.3f %s\n", differences[i].time, differences[i].text);
+    }
+    if(differences.size() > REPLAY_SHOWN) printf("... and %d more\n", (int)differences.size() - REPLAY_SHOWN);
+
+    printf("replayed %.2f s, %d commands differ\n", endTime, (int)differences.size());
+    exit(differences.empty() ? 0 : 1);
+}
+
+static void usage()
+{
+    printf("usage: robot-replay [-v] [-w seconds] [-t percent] trace\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-v") == 0) simConfig.verbose = 1;
+        else if(argv[i][0] != '-' && !name) name = argv[i];
+        else if(i + 1 >= argc) usage();
+        else if(strcmp(argv[i], "-w") == 0) window = atof(argv[++i]);
+        else if(strcmp(argv[i], "-t") == 0) tolerance = atof(argv[++i]);
+        else usage();
+    }
+    if(!name) usage();
+
+    // A program built to record writes its own trace over this one
+    char path[PATH_MAX], here[PATH_MAX];
+    if(realpath(name, path) && realpath(TRACE_FILE, here) && strcmp(path, here) == 0)
+    {
+        fprintf(stderr, "robot-replay: copy %s somewhere else first, the replay writes its own\n", name);
+        return 1;
+    }
+
+    if(!load(name)) return 1;
+
+    simReset();
+    robot_main();
+    simFinish();
+    return 0;
+}
@@ -0,0 +1,641 @@
+// Physics and world model for the host simulator, plus its main()
+
+#include "sim.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+// The robot's own main, renamed when it is built for the host
+int robot_main();
+
+SimConfig simConfig = { 0, 0, 0, 1.0, 300.0, 1, 0, 0 };
+
+// ***************************ROBOT************************
+
+// Physics step
+#define SIM_DT 0.001
+
+// Drive base
+#define WHEEL_BASE 6.5 // inches between the wheels
+#define DISTANCE_PER_COUNT (2.75 * 3.14159 / 32.0)
+#define MAX_WHEEL_SPEED 16.0 // inches per second at 100 percent
+#define MOTOR_DEADBAND 12.0 // percent it takes to get a motor turning
+#define MOTOR_LAG 0.08 // seconds for a motor to get most of the way to speed
+
+// Body, measured from the middle of the axle
+#define ROBOT_FRONT 4.5
+#define ROBOT_BACK 4.5
+#define ROBOT_HALF_WIDTH 4.0
+#define SWITCH_REACH 0.1 // how close a wall has to be to close a bump switch
+#define WALL_SLIP 0.3 // a wheel pushing into a wall still spins this fast
+
+// CdS cell, forward of the axle on the robot bottom
+#define CDS_OFFSET 2.0
+#define CDS_AMBIENT 2.5
+#define CDS_START_LIGHT 2.0
+#define CDS_RED_LIGHT 1.6
+#define CDS_BLUE_LIGHT 0.7
+#define LIGHT_RADIUS 2.0 // a light reads full this close
+#define LIGHT_EDGE 1.0 // and fades out over this much further
+#define CDS_NOISE 0.02
+
+// Battery pack. Motor speeds above are at the nominal voltage and go with
+// the voltage, the pack sags under load and runs down as the motors work.
+#define BATTERY_NOMINAL 11.5
+#define BATTERY_SAG 0.4 // volts lost for every motor at 100 percent
+#define BATTERY_DRAIN 0.004 // volts used up per second of one motor at 100 percent
+#define BATTERY_NOISE 0.02
+
+// Lift
+#define LIFT_MAX_SPEED 14.0 // counts per second at 100 percent
+#define LIFT_TOP 20.0 // counts from the bottom switch to the top
+
+// RPS refresh
+#define RPS_PERIOD 0.1
+
+// How far robots differ from one another with -vary
+#define VARY_MISMATCH 0.05 // either motor this much faster or slower
+#define VARY_SLIP 0.05 // up to this much of the wheel travel lost to the floor
+#define VARY_SWITCH_LATENCY 0.03 // seconds a bump switch may take to close
+#define VARY_BATTERY 0.8 // volts the pack may start above or below nominal
+
+// Pins, must match main.cpp
+#define PIN_CDS 0 // P0_0
+#define PIN_RIGHT_ENCODER 2 // P0_2
+#define PIN_LEFT_ENCODER 8 // P1_0
+#define PIN_LIFT_ENCODER 12 // P1_4
+#define PIN_LIFT_BOTTOM 16 // P2_0
+#define PIN_BACK_LEFT 17 // P2_1
+#define PIN_BACK_RIGHT 18 // P2_2
+
+// The middle button read this many times with no presses left and no motor
+// or encoder touched in between means the program is done and waiting on the
+// operator. Sensor reads don't count as doing something, the services keep
+// reading while the program waits.
+#define IDLE_READS 2000
+
+#define PI 3.14159265
+
+struct Wall
+{
+    double x1, y1, x2, y2;
+};
+
+struct Point
+{
+    double x, y;
+};
+
+struct Robot
+{
+    double x, y, heading; // heading in radians counterclockwise from x
+    double leftSpeed, rightSpeed; // inches per second
+    double leftCounts, rightCounts; // encoders, with the fraction
+    double lift; // counts above the bottom
+    double liftCounts;
+};
+
+static std::vector<Wall> walls;
+static Robot robot;
+static Point start;
+static double startHeading;
+static Point startLight;
+static Point counterLight;
+static Point finish;
+static double finishRadius;
+
+// This robot's quirks, all perfect unless -vary
+static double leftMismatch, rightMismatch;
+static double slip;
+static double switchLatency;
+static double charge; // pack voltage with nothing running
+static double contactStart[2]; // when each back switch got to the wall, -1 when it's off
+
+static double now;
+static double physicsTime;
+static float motors[4];
+static double lightOnTime;
+static double lastMotorTime;
+static double rpsTime;
+static float rpsX, rpsY, rpsHeading;
+static int oven;
+static bool hasOven;
+static unsigned int noiseState;
+static int idleReads;
+
+// Button presses still to come: which button and when it goes down
+struct Press
+{
+    int button;
+    double down;
+};
+static std::vector<Press> presses;
+#define PRESS_TIME 0.1
+
+// ***************************COURSE***********************
+
+// A rough stand-in for the course: the outer walls, the counter and the
+// chiller. Pass a course file with -c to use the real measurements.
+static const char *defaultCourse =
+    "wall 0 0 48 0\n"
+    "wall 48 0 48 72\n"
+    "wall 48 72 0 72\n"
+    "wall 0 72 0 0\n"
+    "wall 0 54 14 54\n" // counter
+    "wall 14 54 14 72\n"
+    "wall 34 60 48 60\n" // chiller
+    "wall 34 60 34 72\n"
+    "start 24 6 90\n"
+    "startlight 24 8\n"
+    "counterlight 14.5 9.5\n" // ahead of where the robot backs up to read it
+    "finish 43 25 10\n"; // in front of the charger
+
+static void parseCourse(const char *text)
+{
+    walls.clear();
+    finishRadius = 0;
+    hasOven = false;
+
+    const char *line = text;
+    while(*line)
+    {
+        char word[32];
+        double a, b, c, d;
+        if(sscanf(line, "%31s", word) == 1 && word[0] != '#')
+        {
+            if(strcmp(word, "wall") == 0 && sscanf(line, "%*s %lf %lf %lf %lf", &a, &b, &c, &d) == 4)
+            {
+                Wall wall = { a, b, c, d };
+                walls.push_back(wall);
+            }
+            else if(strcmp(word, "start") == 0 && sscanf(line, "%*s %lf %lf %lf", &a, &b, &c) == 3)
+            {
+                start.x = a;
+                start.y = b;
+                startHeading = c * PI / 180;
+            }
+            else if(strcmp(word, "startlight") == 0 && sscanf(line, "%*s %lf %lf", &a, &b) == 2)
+            {
+                startLight.x = a;
+                startLight.y = b;
+            }
+            else if(strcmp(word, "counterlight") == 0 && sscanf(line, "%*s %lf %lf", &a, &b) == 2)
+            {
+                counterLight.x = a;
+                counterLight.y = b;
+            }
+            else if(strcmp(word, "oven") == 0)
+            {
+                hasOven = true;
+            }
+            else if(strcmp(word, "finish") == 0 && sscanf(line, "%*s %lf %lf %lf", &a, &b, &c) == 3)
+            {
+                finish.x = a;
+                finish.y = b;
+                finishRadius = c;
+            }
+        }
+
+        line = strchr(line, '\n');
+        if(!line) break;
+        line++;
+    }
+}
+
+static void loadCourse()
+{
+    if(!simConfig.course)
+    {
+        parseCourse(defaultCourse);
+        return;
+    }
+
+    FILE *file = fopen(simConfig.course, "r");
+    if(!file)
+    {
+        fprintf(stderr, "sim: can't open course %s\n", simConfig.course);
+        exit(2);
+    }
+
+    std::vector<char> text;
+    int c;
+    while((c = fgetc(file)) != EOF) text.push_back((char)c);
+    text.push_back(0);
+    fclose(file);
+
+    parseCourse(&text[0]);
+}
+
+// ***************************GEOMETRY*********************
+
+// Point on the robot given its offset forward and to the left of the axle
+static Point bodyPoint(double x, double y, double heading, double forward, double left)
+{
+    Point p;
+    p.x = x + forward * std::cos(heading) - left * std::sin(heading);
+    p.y = y + forward * std::sin(heading) + left * std::cos(heading);
+    return p;
+}
+
+// Corners in order back left, back right, front left, front right
+static void corners(double x, double y, double heading, Point *out)
+{
+    out[0] = bodyPoint(x, y, heading, -ROBOT_BACK, ROBOT_HALF_WIDTH);
+    out[1] = bodyPoint(x, y, heading, -ROBOT_BACK, -ROBOT_HALF_WIDTH);
+    out[2] = bodyPoint(x, y, heading, ROBOT_FRONT, ROBOT_HALF_WIDTH);
+    out[3] = bodyPoint(x, y, heading, ROBOT_FRONT, -ROBOT_HALF_WIDTH);
+}
+
+static double cross(Point o, Point a, Point b)
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+// Does the path from p to q go through a wall
+static bool hitsWall(Point p, Point q)
+{
+    for(size_t i = 0; i < walls.size(); i++)
+    {
+        Point a = { walls[i].x1, walls[i].y1 };
+        Point b = { walls[i].x2, walls[i].y2 };
+        double d1 = cross(a, b, p), d2 = cross(a, b, q);
+        double d3 = cross(p, q, a), d4 = cross(p, q, b);
+        if(((d1 > 0 && d2 <= 0) || (d1 < 0 && d2 >= 0) || (d1 == 0 && d2 != 0)) &&
+           ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0))) return true;
+    }
+    return false;
+}
+
+static double wallDistance(Point p)
+{
+    double best = 1e9;
+    for(size_t i = 0; i < walls.size(); i++)
+    {
+        double dx = walls[i].x2 - walls[i].x1, dy = walls[i].y2 - walls[i].y1;
+        double t = ((p.x - walls[i].x1) * dx + (p.y - walls[i].y1) * dy) / (dx * dx + dy * dy);
+        if(t < 0) t = 0;
+        if(t > 1) t = 1;
+        double ex = walls[i].x1 + t * dx - p.x, ey = walls[i].y1 + t * dy - p.y;
+        double d = std::sqrt(ex * ex + ey * ey);
+        if(d < best) best = d;
+    }
+    return best;
+}
+
+// ***************************PHYSICS**********************
+
+static double noise()
+{
+    noiseState = noiseState * 1103515245 + 12345;
+    return ((noiseState >> 8) & 0xffff) / 32768.0 - 1;
+}
+
+// Share of full power the motors are drawing, 1 for each one at 100 percent
+static double motorLoad()
+{
+    double load = 0;
+    for(int i = 0; i < 4; i++) load += std::fabs(motors[i]) > 100 ? 1 : std::fabs(motors[i]) / 100;
+    return load;
+}
+
+// What the pack gives under the load right now
+static double batteryVolts()
+{
+    return charge - BATTERY_SAG * motorLoad();
+}
+
+static double wheelSpeedFor(float percent)
+{
+    // A percent of a low pack is less voltage at the motor
+    percent *= batteryVolts() / BATTERY_NOMINAL;
+
+    double magnitude = std::fabs(percent);
+    if(magnitude > 100) magnitude = 100;
+    if(magnitude < MOTOR_DEADBAND) return 0;
+
+    double speed = (magnitude - MOTOR_DEADBAND) / (100 - MOTOR_DEADBAND) * MAX_WHEEL_SPEED;
+    return percent < 0 ? -speed : speed;
+}
+
+// Which corners would go through a wall if the wheels rolled this far
+static int blockedCorners(double left, double right)
+{
+    double distance = (left + right) / 2;
+    double turn = (right - left) / WHEEL_BASE;
+    double middle = robot.heading + turn / 2;
+    double x = robot.x + distance * std::cos(middle);
+    double y = robot.y + distance * std::sin(middle);
+
+    Point before[4], after[4];
+    corners(robot.x, robot.y, robot.heading, before);
+    corners(x, y, robot.heading + turn, after);
+
+    int blocked = 0;
+    for(int i = 0; i < 4; i++)
+    {
+        if(hitsWall(before[i], after[i])) blocked |= 1 << i;
+    }
+    return blocked;
+}
+
+static void step(double dt)
+{
+    charge -= BATTERY_DRAIN * motorLoad() * dt;
+
+    // Motors get most of the way to their new speed in MOTOR_LAG
+    double follow = dt / (MOTOR_LAG + dt);
+    robot.leftSpeed += (wheelSpeedFor(motors[SIM_LEFT_MOTOR]) * leftMismatch - robot.leftSpeed) * follow;
+    robot.rightSpeed += (wheelSpeedFor(motors[SIM_RIGHT_MOTOR]) * rightMismatch - robot.rightSpeed) * follow;
+
+    // Some of the travel is lost to the floor, the encoders still count it
+    double left = robot.leftSpeed * dt * (1 - slip);
+    double right = robot.rightSpeed * dt * (1 - slip);
+
+    // A corner against a wall stops the wheel on its side, so the robot
+    // swings around the other wheel the way it squares up on a real wall
+    int blocked = blockedCorners(left, right);
+    bool leftBlocked = blocked & (1 | 4);
+    bool rightBlocked = blocked & (2 | 8);
+    if(blocked && blockedCorners(leftBlocked ? 0 : left, rightBlocked ? 0 : right)) leftBlocked = rightBlocked = true;
+
+    // A stuck wheel slips on the floor, the encoder still sees it turn slowly
+    double leftSpun = robot.leftSpeed * dt, rightSpun = robot.rightSpeed * dt;
+    if(leftBlocked)
+    {
+        left = 0;
+        leftSpun *= WALL_SLIP;
+    }
+    if(rightBlocked)
+    {
+        right = 0;
+        rightSpun *= WALL_SLIP;
+    }
+
+    double distance = (left + right) / 2;
+    double turn = (right - left) / WHEEL_BASE;
+    double middle = robot.heading + turn / 2;
+    robot.x += distance * std::cos(middle);
+    robot.y += distance * std::sin(middle);
+    robot.heading += turn;
+
+    robot.leftCounts += std::fabs(leftSpun) / DISTANCE_PER_COUNT;
+    robot.rightCounts += std::fabs(rightSpun) / DISTANCE_PER_COUNT;
+
+    // Negative percent raises the lift
+    double lift = -wheelSpeedFor(motors[SIM_LIFT_MOTOR]) / MAX_WHEEL_SPEED * LIFT_MAX_SPEED * dt;
+    double newLift = robot.lift + lift;
+    if(newLift < 0) newLift = 0;
+    if(newLift > LIFT_TOP) newLift = LIFT_TOP;
+    robot.liftCounts += std::fabs(newLift - robot.lift);
+    robot.lift = newLift;
+
+    // Note when each back switch reached the wall
+    Point c[4];
+    corners(robot.x, robot.y, robot.heading, c);
+    for(int i = 0; i < 2; i++)
+    {
+        if(wallDistance(c[i]) > SWITCH_REACH) contactStart[i] = -1;
+        else if(contactStart[i] < 0) contactStart[i] = physicsTime;
+    }
+}
+
+// ***************************CLOCK************************
+
+void simAdvance(double seconds)
+{
+    now += seconds;
+
+    while(physicsTime + SIM_DT <= now)
+    {
+        step(SIM_DT);
+        physicsTime += SIM_DT;
+    }
+
+    if(now > simConfig.timeLimit)
+    {
+        printf("sim: timed out after %.2f s\n", now);
+        exit(1);
+    }
+}
+
+double simTime()
+{
+    return now;
+}
+
+// ***************************HARDWARE*********************
+
+void simMotor(int port, float percent)
+{
+    if(port < 0 || port >= 4) return;
+
+    // The same command again (the battery service resends them) isn't doing
+    // anything new
+    if(percent != motors[port]) idleReads = 0;
+    motors[port] = percent;
+    lastMotorTime = now;
+}
+
+int simEncoderCounts(int pin)
+{
+    simAdvance(SIM_READ_CALL);
+    if(pin == PIN_LEFT_ENCODER) return (int)robot.leftCounts;
+    if(pin == PIN_RIGHT_ENCODER) return (int)robot.rightCounts;
+    if(pin == PIN_LIFT_ENCODER) return (int)robot.liftCounts;
+    return 0;
+}
+
+void simEncoderReset(int pin)
+{
+    idleReads = 0;
+    if(pin == PIN_LEFT_ENCODER) robot.leftCounts = 0;
+    if(pin == PIN_RIGHT_ENCODER) robot.rightCounts = 0;
+    if(pin == PIN_LIFT_ENCODER) robot.liftCounts = 0;
+}
+
+static double lightNear(Point p, Point light)
+{
+    double d = std::sqrt((p.x - light.x) * (p.x - light.x) + (p.y - light.y) * (p.y - light.y));
+    if(d < LIGHT_RADIUS) return 1;
+    return d < LIGHT_RADIUS + LIGHT_EDGE ? 1 - (d - LIGHT_RADIUS) / LIGHT_EDGE : 0;
+}
+
+float simAnalog(int pin)
+{
+    simAdvance(SIM_READ_CALL);
+    if(pin != PIN_CDS) return 0;
+
+    // Lights pull the CdS voltage down
+    Point cds = bodyPoint(robot.x, robot.y, robot.heading, CDS_OFFSET, 0);
+    double value = CDS_AMBIENT + CDS_NOISE * noise();
+    if(now >= lightOnTime) value -= CDS_START_LIGHT * lightNear(cds, startLight);
+    value -= (simConfig.blue ? CDS_BLUE_LIGHT : CDS_RED_LIGHT) * lightNear(cds, counterLight);
+    return value;
+}
+
+int simDigital(int pin)
+{
+    simAdvance(SIM_READ_CALL);
+
+    // Switches read 0 when pressed
+    if(pin == PIN_LIFT_BOTTOM) return robot.lift > 0 ? 1 : 0;
+
+    // Back switches close a little after they get to the wall
+    int back = pin == PIN_BACK_LEFT ? 0 : pin == PIN_BACK_RIGHT ? 1 : -1;
+    if(back >= 0) return contactStart[back] >= 0 && now - contactStart[back] >= switchLatency ? 0 : 1;
+    return 1;
+}
+
+int simButton(int button)
+{
+    simAdvance(SIM_READ_CALL);
+
+    // Drop presses that are over
+    while(!presses.empty() && now >= presses[0].down + 2 * PRESS_TIME) presses.erase(presses.begin());
+
+    if(presses.empty())
+    {
+        // Nothing left to press and the program keeps asking for M, it's done
+        if(button == 1 && ++idleReads >= IDLE_READS) simFinish();
+        return 0;
+    }
+
+    idleReads = 0;
+    return presses[0].button == button && now >= presses[0].down && now < presses[0].down + PRESS_TIME;
+}
+
+void simRPS(float &x, float &y, float &heading)
+{
+    simAdvance(SIM_READ_CALL);
+
+    // RPS only refreshes a few times a second
+    if(now - rpsTime >= RPS_PERIOD)
+    {
+        rpsTime = now;
+        rpsX = std::floor(robot.x * 10 + .5) / 10;
+        rpsY = std::floor(robot.y * 10 + .5) / 10;
+        double degrees = std::fmod(robot.heading * 180 / PI, 360.0);
+        if(degrees < 0) degrees += 360;
+        rpsHeading = std::floor(degrees + .5);
+    }
+    x = rpsX;
+    y = rpsY;
+    heading = rpsHeading;
+}
+
+int simOven()
+{
+    return oven;
+}
+
+float simBattery()
+{
+    // Not counted as the program doing something, it may watch the pack while idle
+    simAdvance(SIM_READ_CALL);
+    return batteryVolts() + BATTERY_NOISE * noise();
+}
+
+// ***************************RUN**************************
+
+void simReset()
+{
+    loadCourse();
+
+    memset(&robot, 0, sizeof(robot));
+    robot.x = start.x;
+    robot.y = start.y;
+    robot.heading = startHeading;
+
+    now = physicsTime = 0;
+    rpsTime = -RPS_PERIOD;
+    lastMotorTime = 0;
+    idleReads = 0;
+    for(int i = 0; i < 4; i++) motors[i] = 0;
+    noiseState = simConfig.seed;
+    // No oven on the course, no presses asked for
+    oven = hasOven ? 1 + (simConfig.seed % 3) : 0;
+
+    // A different robot for every seed
+    leftMismatch = rightMismatch = 1;
+    slip = switchLatency = 0;
+    charge = BATTERY_NOMINAL;
+    if(simConfig.vary)
+    {
+        leftMismatch = 1 + VARY_MISMATCH * noise();
+        rightMismatch = 1 + VARY_MISMATCH * noise();
+        slip = VARY_SLIP * (noise() + 1) / 2;
+        switchLatency = VARY_SWITCH_LATENCY * (noise() + 1) / 2;
+        charge = BATTERY_NOMINAL + VARY_BATTERY * noise();
+    }
+    contactStart[0] = contactStart[1] = -1;
+
+    // Press right to get to the segment, then middle to go
+    presses.clear();
+    double t = PRESS_TIME;
+    for(int i = 0; i < simConfig.segment; i++)
+    {
+        Press press = { 2, t };
+        presses.push_back(press);
+        t += 2 * PRESS_TIME;
+    }
+    Press go = { 1, t };
+    presses.push_back(go);
+
+    // The course clock starts with the light after the last press
+    lightOnTime = t + PRESS_TIME + simConfig.lightTime;
+}
+
+static clock_t realStart;
+
+void simFinish()
+{
+    // Starting past segment one there's no start light to wait for
+    double courseStart = simConfig.segment == 0 ? lightOnTime : lightOnTime - simConfig.lightTime;
+
+    printf("course time %.2f s\n", lastMotorTime - courseStart);
+    printf("final pose %.1f %.1f %.0f\n", robot.x, robot.y, std::fmod(robot.heading * 180 / PI + 3600, 360.0));
+    printf("sim time %.2f s, real time %.3f s\n", now, (double)(clock() - realStart) / CLOCKS_PER_SEC);
+
+    // A whole course run has to end up at the finish
+    double dx = robot.x - finish.x, dy = robot.y - finish.y;
+    if(simConfig.segment == 0 && finishRadius > 0 && dx * dx + dy * dy > finishRadius * finishRadius)
+    {
+        printf("sim: missed the finish\n");
+        exit(3);
+    }
+    exit(0);
+}
+
+static void usage()
+{
+    printf("usage: robot-sim [-v] [-vary] [-s segment] [-blue | -red] [-light seconds] [-limit seconds] [-seed n] [-c course]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-v") == 0) simConfig.verbose = 1;
+        else if(strcmp(argv[i], "-vary") == 0) simConfig.vary = 1;
+        else if(strcmp(argv[i], "-blue") == 0) simConfig.blue = 1;
+        else if(strcmp(argv[i], "-red") == 0) simConfig.blue = 0;
+        else if(i + 1 >= argc) usage();
+        else if(strcmp(argv[i], "-s") == 0) simConfig.segment = atoi(argv[++i]) - 1;
+        else if(strcmp(argv[i], "-light") == 0) simConfig.lightTime = atof(argv[++i]);
+        else if(strcmp(argv[i], "-limit") == 0) simConfig.timeLimit = atof(argv[++i]);
+        else if(strcmp(argv[i], "-seed") == 0) simConfig.seed = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-c") == 0) simConfig.course = argv[++i];
+        else usage();
+    }
+    if(simConfig.segment < 0) simConfig.segment = 0;
+
+    realStart = clock();
+    simReset();
+    robot_main();
+    simFinish();
+    return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef SIM_H
+#define SIM_H
+
+// Host simulator for the robot. The robot program runs unchanged on top of
+// stand-in FEH headers. Time is virtual: it moves on a little with every
+// hardware call and by the full amount on Sleep(), and the physics is stepped
+// as it goes. That makes a run repeatable and much faster than real time.
+
+// Wiring, must match the pins in main.cpp
+#define SIM_LEFT_MOTOR 0
+#define SIM_RIGHT_MOTOR 1
+#define SIM_LIFT_MOTOR 3
+
+// How long hardware calls take on the real controller
+#define SIM_TIME_CALL 0.000005 // TimeNow()
+#define SIM_READ_CALL 0.00002 // any pin read
+#define SIM_LCD_CALL 0.004 // one LCD write
+
+// Settings for one simulated run
+struct SimConfig
+{
+    int verbose; // echo the LCD to stdout
+    int segment; // mission segment to start from (button presses to get there)
+    int blue; // color of the light on the counter
+    double lightTime; // seconds after start before the start light comes on
+    double timeLimit; // give up after this long
+    unsigned int seed; // for the sensor noise
+    const char *course; // course file, 0 for the built in one
+    int vary; // give every seed its own wheel slip, motor mismatch and switch latency
+};
+
+extern SimConfig simConfig;
+
+// Set the world up from simConfig and put the robot at the start
+void simReset();
+
+// Move virtual time on, stepping the physics as we go
+void simAdvance(double seconds);
+
+// Virtual seconds since the program started
+double simTime();
+
+// Stand-in hardware calls
+void simMotor(int port, float percent);
+int simEncoderCounts(int pin);
+void simEncoderReset(int pin);
+float simAnalog(int pin);
+int simDigital(int pin);
+int simButton(int button);
+void simRPS(float &x, float &y, float &heading);
+int simOven();
+float simBattery();
+
+// The program is sitting idle waiting for buttons, print the results and exit
+void simFinish();
+
+#endif // SIM_H
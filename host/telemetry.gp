@@ -0,0 +1,19 @@
+# Plot a decoded telemetry run: gnuplot -e "file='run.csv'" telemetry.gp
+if (!exists("file")) file = 'run.csv'
+
+set datafile separator ","
+set key autotitle columnhead
+set multiplot layout 3,1
+set xlabel "seconds"
+
+set ylabel "counts"
+plot file using 1:2 with lines, '' using 1:3 with lines, '' using 1:4 with lines
+
+set ylabel "percent"
+plot file using 1:9 with lines, '' using 1:10 with lines, '' using 1:11 with lines
+
+set ylabel "inches / switches"
+plot file using 1:6 with lines, '' using 1:7 with lines, '' using 1:12 with steps, '' using 1:13 with steps
+
+unset multiplot
+pause mouse close
@@ -0,0 +1,523 @@
+// Runs the simulator many times over with the robot varied from run to run
+// and reports how fast and how reliably each set of settings gets round the
+// course and how many moves it gives up on the way, or searches for the
+// fastest settings that still finish.
+//
+//   robot-tune [-n trials] [-j jobs] [-c course] file...   compare settings
+//   robot-tune -p speedHigh=70,80,90 [file]                sweep one setting
+//   robot-tune -o rounds [-f failures] [-k tries] [file]   search
+//
+// A settings file has the same "name value" lines as TUNE.TXT, settings it
+// leaves out keep their compiled-in values. With no file the compiled-in
+// values are used. The search writes the best it found to TUNE.TXT.
+//
+// Every seed runs once with a red counter light and once with a blue one. A
+// seed that runs the same both ways fails both, the robot never took the
+// colour's branch, so the course has to have a counter light.
+
+#include "../tuning.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/wait.h>
+
+// Settings the tuner knows about, with the values compiled into the robot and
+// how far the search may take them (all from tuning.h)
+struct Setting
+{
+    const char *name;
+    double start;
+    double low, high;
+};
+
+#define TUNE_SETTING(name, start, low, high) { #name, start, low, high },
+static const Setting settings[] = { TUNING_SETTINGS(TUNE_SETTING) };
+
+static const int numSettings = sizeof(settings) / sizeof(Setting);
+
+// Defaults for the command line
+#define TUNE_TRIALS 50 // seeds, each run with both colours
+#define TUNE_TRIES 8 // candidates per search round
+#define TUNE_FAILURES 0.05 // most runs a search result may fail
+#define TUNE_STEP 0.15 // first search step as a share of each setting's range
+#define TUNE_SHRINK 0.7 // step kept after a round with nothing better
+#define TUNE_LIMIT 200.0 // simulated seconds before a run counts as stuck
+#define TUNE_GIVE_UP_COST 5.0 // seconds a move given up counts for in the search
+
+// One set of settings, and how it did
+struct Candidate
+{
+    double value[numSettings];
+    bool given[numSettings]; // false keeps the compiled-in value
+    int runs, failures;
+    std::vector<double> times;
+    int givenUp; // moves given up over the runs that finished
+};
+
+// One simulator run, and what it said
+struct Trial
+{
+    int candidate;
+    unsigned int seed;
+    bool blue;
+    pid_t pid;
+    std::string dir;
+
+    bool finished; // got to the finish in time
+    double time;
+    std::string pose;
+    int givenUp;
+};
+
+static std::string simPath;
+static const char *course = 0;
+static int jobs = 0;
+
+static Candidate defaults()
+{
+    Candidate candidate;
+    for(int i = 0; i < numSettings; i++)
+    {
+        candidate.value[i] = settings[i].start;
+        candidate.given[i] = false;
+    }
+    candidate.runs = candidate.failures = candidate.givenUp = 0;
+    return candidate;
+}
+
+static int findSetting(const char *name)
+{
+    for(int i = 0; i < numSettings; i++)
+    {
+        if(strcmp(settings[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+static bool loadCandidate(const char *name, Candidate &candidate)
+{
+    FILE *file = fopen(name, "r");
+    if(!file)
+    {
+        fprintf(stderr, "robot-tune: can't open %s\n", name);
+        return false;
+    }
+
+    char key[32];
+    double value;
+    while(fscanf(file, "%31s %lf", key, &value) == 2)
+    {
+        int i = findSetting(key);
+        if(i < 0) fprintf(stderr, "robot-tune: %s doesn't tune %s, ignored\n", name, key);
+        else
+        {
+            candidate.value[i] = value;
+            candidate.given[i] = true;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+static bool saveCandidate(const char *name, const Candidate &candidate)
+{
+    FILE *file = fopen(name, "w");
+    if(!file) return false;
+
+    for(int i = 0; i < numSettings; i++)
+    {
+        if(candidate.given[i]) fprintf(file, "%s %f\n", settings[i].name, candidate.value[i]);
+    }
+
+    fclose(file);
+    return true;
+}
+
+// ***************************RUNS*************************
+
+// Start a run in a directory of its own, the robot reads and writes files
+// in the one it runs in
+static bool startTrial(Trial &trial, const Candidate &candidate)
+{
+    char dir[] = "/tmp/robot-tune.XXXXXX";
+    if(!mkdtemp(dir)) return false;
+    trial.dir = dir;
+
+    if(!saveCandidate((trial.dir + "/" + TUNING_FILE).c_str(), candidate)) return false;
+
+    char seed[16], limit[16];
+    snprintf(seed, sizeof(seed), "%u", trial.seed);
+    snprintf(limit, sizeof(limit), "%g", TUNE_LIMIT);
+
+    trial.pid = fork();
+    if(trial.pid < 0) return false;
+    if(trial.pid == 0)
+    {
+        if(chdir(trial.dir.c_str()) != 0) _exit(127);
+        int out = open("out.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(out < 0) _exit(127);
+        dup2(out, 1);
+        close(out);
+
+        // The screen goes to the output too, for the end of run report
+        const char *colour = trial.blue ? "-blue" : "-red";
+        if(course) execl(simPath.c_str(), "robot-sim", "-v", "-vary", colour, "-seed", seed, "-limit", limit, "-c", course, (char *)0);
+        else execl(simPath.c_str(), "robot-sim", "-v", "-vary", colour, "-seed", seed, "-limit", limit, (char *)0);
+        _exit(127);
+    }
+    return true;
+}
+
+// Read what a finished run said and clean up after it
+static void finishTrial(Trial &trial, int status)
+{
+    bool timed = false;
+    trial.time = 0;
+    trial.givenUp = 0;
+
+    FILE *file = fopen((trial.dir + "/out.txt").c_str(), "r");
+    if(file)
+    {
+        char line[256];
+        while(fgets(line, sizeof(line), file))
+        {
+            if(sscanf(line, "course time %lf", &trial.time) == 1) timed = true;
+            if(strncmp(line, "final pose", 10) == 0) trial.pose = line;
+            sscanf(line, "Moves given up %d", &trial.givenUp);
+        }
+        fclose(file);
+    }
+    trial.finished = WIFEXITED(status) && WEXITSTATUS(status) == 0 && timed;
+
+    // Everything the robot wrote goes, whatever files it has taken to writing
+    DIR *dir = opendir(trial.dir.c_str());
+    if(dir)
+    {
+        struct dirent *entry;
+        while((entry = readdir(dir)) != 0)
+        {
+            if(strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+                unlink((trial.dir + "/" + entry->d_name).c_str());
+        }
+        closedir(dir);
+    }
+    if(rmdir(trial.dir.c_str()) != 0) fprintf(stderr, "robot-tune: couldn't remove %s\n", trial.dir.c_str());
+}
+
+// Run every candidate on the same seeds, each seed once with a red light and
+// once with a blue one, as many runs at a time as asked for
+static void evaluate(std::vector<Candidate> &candidates, int trials, unsigned int firstSeed)
+{
+    std::vector<Trial> runs;
+    for(unsigned int c = 0; c < candidates.size(); c++)
+    {
+        for(int i = 0; i < 2 * trials; i++)
+        {
+            Trial trial;
+            trial.candidate = c;
+            trial.seed = firstSeed + i / 2;
+            trial.blue = i % 2;
+            trial.pid = 0;
+            trial.finished = false;
+            runs.push_back(trial);
+        }
+    }
+
+    std::vector<int> running;
+    unsigned int next = 0;
+    while(next < runs.size() || !running.empty())
+    {
+        while(next < runs.size() && (int)running.size() < jobs)
+        {
+            Trial &trial = runs[next];
+            if(!startTrial(trial, candidates[trial.candidate]))
+            {
+                fprintf(stderr, "robot-tune: can't start a run\n");
+                exit(1);
+            }
+            running.push_back(next++);
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        if(pid < 0) break;
+        for(unsigned int i = 0; i < running.size(); i++)
+        {
+            if(runs[running[i]].pid == pid)
+            {
+                finishTrial(runs[running[i]], status);
+                running.erase(running.begin() + i);
+                break;
+            }
+        }
+    }
+
+    for(unsigned int c = 0; c < candidates.size(); c++)
+    {
+        candidates[c].runs = candidates[c].failures = candidates[c].givenUp = 0;
+        candidates[c].times.clear();
+    }
+
+    // A seed that ran the same with either light never took the colour's
+    // branch, the light made no difference, so neither run counts
+    for(unsigned int i = 0; i + 1 < runs.size(); i += 2)
+    {
+        const Trial &red = runs[i], &blue = runs[i + 1];
+        Candidate &candidate = candidates[red.candidate];
+        bool same = red.finished && blue.finished && red.time == blue.time && red.pose == blue.pose;
+        for(int k = 0; k < 2; k++)
+        {
+            const Trial &trial = runs[i + k];
+            candidate.runs++;
+            if(!trial.finished || same) candidate.failures++;
+            else
+            {
+                candidate.times.push_back(trial.time);
+                candidate.givenUp += trial.givenUp;
+            }
+        }
+    }
+}
+
+// ***************************REPORT***********************
+
+static double failureRate(const Candidate &candidate)
+{
+    return candidate.runs ? (double)candidate.failures / candidate.runs : 1;
+}
+
+static double meanTime(const Candidate &candidate)
+{
+    if(candidate.times.empty()) return INFINITY;
+
+    double sum = 0;
+    for(unsigned int i = 0; i < candidate.times.size(); i++) sum += candidate.times[i];
+    return sum / candidate.times.size();
+}
+
+static double meanGivenUp(const Candidate &candidate)
+{
+    if(candidate.times.empty()) return INFINITY;
+    return (double)candidate.givenUp / candidate.times.size();
+}
+
+static double percentile(const Candidate &candidate, double share)
+{
+    if(candidate.times.empty()) return INFINITY;
+
+    std::vector<double> sorted = candidate.times;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[(int)(share * (sorted.size() - 1) + .5)];
+}
+
+static void describe(const Candidate &candidate)
+{
+    bool any = false;
+    for(int i = 0; i < numSettings; i++)
+    {
+        if(!candidate.given[i]) continue;
+        printf(" %s=%g", settings[i].name, candidate.value[i]);
+        any = true;
+    }
+    if(!any) printf(" compiled-in");
+}
+
+static void report(const char *label, const Candidate &candidate)
+{
+    printf("%-10s %4d runs %5.1f%% failed  mean %6.2f s  p90 %6.2f s  given up %4.1f ", label, candidate.runs,
+           100 * failureRate(candidate), meanTime(candidate), percentile(candidate, .9), meanGivenUp(candidate));
+    describe(candidate);
+    printf("\n");
+    fflush(stdout);
+}
+
+// ***************************SEARCH***********************
+
+static double gaussian()
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return std::sqrt(-2 * std::log(u)) * std::cos(2 * M_PI * v);
+}
+
+// What a candidate's runs cost on average. A move given up still gets the
+// robot to the finish, but skips whatever the move was for, so it costs time
+// as well. Otherwise driving flat out into walls looks fastest.
+static double cost(const Candidate &candidate)
+{
+    return meanTime(candidate) + TUNE_GIVE_UP_COST * meanGivenUp(candidate);
+}
+
+// Whether a beats b. Failing rarely enough beats failing too often. Two
+// that fail rarely enough go by the cost. Two that fail too often go by how
+// often they fail and then the cost, so a search that starts out failing a
+// lot still climbs toward settings that don't.
+static bool better(const Candidate &a, const Candidate &b, double failures)
+{
+    double aFailed = failureRate(a), bFailed = failureRate(b);
+    bool aGood = aFailed <= failures, bGood = bFailed <= failures;
+    if(aGood != bGood) return aGood;
+    if(!aGood && aFailed != bFailed) return aFailed < bFailed;
+    return cost(a) < cost(b);
+}
+
+// Random search around the best so far. Every round the best is run again
+// next to a few nudged copies of it on fresh seeds, so they are compared on
+// the same robots, and the step shrinks whenever none of them does better.
+static Candidate search(Candidate best, int rounds, int tries, int trials, double failures)
+{
+    for(int i = 0; i < numSettings; i++) best.given[i] = true;
+
+    double step = TUNE_STEP;
+    unsigned int seed = 1000;
+    for(int round = 1; round <= rounds; round++)
+    {
+        std::vector<Candidate> candidates(1, best);
+        for(int t = 0; t < tries; t++)
+        {
+            Candidate nudged = best;
+            for(int i = 0; i < numSettings; i++)
+            {
+                double range = settings[i].high - settings[i].low;
+                nudged.value[i] = std::min(settings[i].high, std::max(settings[i].low, best.value[i] + step * range * gaussian()));
+            }
+            candidates.push_back(nudged);
+        }
+
+        evaluate(candidates, trials, seed);
+        seed += trials;
+
+        int winner = 0;
+        for(unsigned int c = 1; c < candidates.size(); c++)
+        {
+            if(better(candidates[c], candidates[winner], failures)) winner = c;
+        }
+        if(winner == 0) step *= TUNE_SHRINK;
+        best = candidates[winner];
+
+        char label[32];
+        snprintf(label, sizeof(label), "round %d", round);
+        report(label, best);
+    }
+    return best;
+}
+
+// ***************************MAIN*************************
+
+static void usage()
+{
+    printf("usage: robot-tune [-n trials] [-j jobs] [-c course] [-p name=v1,v2,...] [-o rounds [-f failures] [-k tries]] [file...]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    int trials = TUNE_TRIALS, rounds = 0, tries = TUNE_TRIES;
+    double failures = TUNE_FAILURES;
+    const char *sweep = 0;
+    std::vector<const char *> files;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(argv[i][0] != '-') files.push_back(argv[i]);
+        else if(i + 1 >= argc) usage();
+        else if(strcmp(argv[i], "-n") == 0) trials = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-j") == 0) jobs = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-c") == 0) course = argv[++i];
+        else if(strcmp(argv[i], "-p") == 0) sweep = argv[++i];
+        else if(strcmp(argv[i], "-o") == 0) rounds = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-f") == 0) failures = atof(argv[++i]);
+        else if(strcmp(argv[i], "-k") == 0) tries = atoi(argv[++i]);
+        else usage();
+    }
+    if(trials < 1) usage();
+    if(jobs < 1) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(jobs < 1) jobs = 1;
+
+    // The simulator sits next to this program, the course goes to it from
+    // another directory
+    char self[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if(length <= 0) return 1;
+    self[length] = 0;
+    simPath = std::string(self, strrchr(self, '/') - self) + "/robot-sim";
+
+    char coursePath[PATH_MAX];
+    if(course)
+    {
+        if(!realpath(course, coursePath))
+        {
+            fprintf(stderr, "robot-tune: can't find %s\n", course);
+            return 1;
+        }
+        course = coursePath;
+    }
+
+    // Settings to start from
+    std::vector<Candidate> candidates;
+    for(unsigned int i = 0; i < files.size(); i++)
+    {
+        Candidate candidate = defaults();
+        if(!loadCandidate(files[i], candidate)) return 1;
+        candidates.push_back(candidate);
+    }
+    if(candidates.empty()) candidates.push_back(defaults());
+
+    if(rounds > 0)
+    {
+        std::vector<Candidate> start(1, candidates[0]);
+        evaluate(start, trials, 1);
+        report("start", start[0]);
+
+        Candidate best = search(candidates[0], rounds, tries, trials, failures);
+        if(!saveCandidate(TUNING_FILE, best))
+        {
+            fprintf(stderr, "robot-tune: can't write %s\n", TUNING_FILE);
+            return 1;
+        }
+        printf("best written to %s\n", TUNING_FILE);
+        return 0;
+    }
+
+    // One setting at each of a list of values, on top of the first file
+    if(sweep)
+    {
+        char name[32];
+        const char *values = strchr(sweep, '=');
+        int setting = -1;
+        if(values && values - sweep < (int)sizeof(name))
+        {
+            memcpy(name, sweep, values - sweep);
+            name[values - sweep] = 0;
+            setting = findSetting(name);
+        }
+        if(setting < 0) usage();
+
+        Candidate base = candidates[0];
+        candidates.clear();
+        for(const char *value = values + 1; *value; value = strchr(value, ',') ? strchr(value, ',') + 1 : "")
+        {
+            Candidate candidate = base;
+            candidate.value[setting] = atof(value);
+            candidate.given[setting] = true;
+            candidates.push_back(candidate);
+        }
+    }
+
+    evaluate(candidates, trials, 1);
+    for(unsigned int c = 0; c < candidates.size(); c++)
+    {
+        char label[32];
+        snprintf(label, sizeof(label), "set %u", c + 1);
+        report(label, candidates[c]);
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include "inputs.h"
+
+DebouncedInput::DebouncedInput()
+{
+    state = false;
+    rising = false;
+    falling = false;
+    pending = false;
+    changeTime = -INPUT_DEBOUNCE;
+    seenTime = changeTime;
+}
+
+void DebouncedInput::sample(bool pressed, double now)
+{
+    rising = false;
+    falling = false;
+
+    if(pressed == state)
+    {
+        pending = false;
+        return;
+    }
+    if(!pending)
+    {
+        pending = true;
+        seenTime = now;
+    }
+
+    // Anything while it is still settling is bounce
+    if(now - changeTime < INPUT_DEBOUNCE) return;
+
+    state = pressed;
+    rising = pressed;
+    falling = !pressed;
+    pending = false;
+    changeTime = now;
+}
+
+ReactionTimer::ReactionTimer()
+{
+    reactions = 0;
+    total = 0;
+    longest = 0;
+}
+
+void ReactionTimer::add(double seconds)
+{
+    reactions++;
+    total += seconds;
+    if(seconds > longest) longest = seconds;
+}
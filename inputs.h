@@ -0,0 +1,60 @@
+#ifndef INPUTS_H
+#define INPUTS_H
+
+// Once a switch changes it is held there this long, so contact bounce
+// doesn't turn one bump into several edges (seconds)
+#define INPUT_DEBOUNCE 0.02
+
+// One switch or button, read once a tick. A change is taken the tick it is
+// seen, so debouncing adds no delay to the first edge. One that comes while
+// the last is still settling is held until it has.
+class DebouncedInput
+{
+public:
+    DebouncedInput();
+
+    // Give it this tick's read
+    void sample(bool pressed, double now);
+
+    bool pressed() const { return state; }
+
+    // Whether it was pressed or let go on the last sample
+    bool rose() const { return rising; }
+    bool fell() const { return falling; }
+
+    // When the last edge was taken
+    double changedAt() const { return changeTime; }
+
+    // When the read first showed the last edge, before any hold for bounce
+    double seenAt() const { return seenTime; }
+
+private:
+    bool state;
+    bool rising;
+    bool falling;
+    bool pending;
+    double changeTime;
+    double seenTime;
+};
+
+// Time from an input first reading changed to the motors doing something
+// about it, any hold for bounce included. Reads happen at the start of a
+// tick, so add up to a tick for when the switch really closed.
+class ReactionTimer
+{
+public:
+    ReactionTimer();
+
+    void add(double seconds);
+
+    int count() const { return reactions; }
+    double worst() const { return longest; }
+    double mean() const { return reactions > 0 ? total / reactions : 0; }
+
+private:
+    int reactions;
+    double total;
+    double longest;
+};
+
+#endif // INPUTS_H
@@ -0,0 +1,81 @@
+#include "light.h"
+#include <cmath>
+
+SequentialTest::SequentialTest(float mean0, float mean1, float noise, float alpha, float beta, float maxStep)
+{
+    this->mean0 = mean0;
+    this->mean1 = mean1;
+    this->maxStep = maxStep;
+    variance = noise * noise;
+    upper = std::log((1 - beta) / alpha);
+    lower = std::log(beta / (1 - alpha));
+    reset();
+}
+
+void SequentialTest::reset()
+{
+    total = 0;
+    count = 0;
+}
+
+int SequentialTest::add(float x)
+{
+    float step = ((x - mean0) * (x - mean0) - (x - mean1) * (x - mean1)) / (2 * variance);
+    if(step > maxStep) step = maxStep;
+    if(step < -maxStep) step = -maxStep;
+
+    total += step;
+    count++;
+
+    if(total >= upper) return 1;
+    if(total <= lower) return -1;
+    return 0;
+}
+
+LightSensor::LightSensor(TracedAnalogPin &pin) : pin(pin)
+{
+    for(int i = 0; i < LIGHT_WINDOW; i++) window[i] = 0;
+    next = 0;
+    filled = 0;
+    baseline = 0;
+}
+
+bool LightSensor::update()
+{
+    float sum = 0;
+    for(int i = 0; i < LIGHT_OVERSAMPLE; i++) sum += pin.Value();
+
+    window[next] = sum / LIGHT_OVERSAMPLE;
+    next = (next + 1) % LIGHT_WINDOW;
+    if(filled < LIGHT_WINDOW) filled++;
+    return false;
+}
+
+float LightSensor::mean() const
+{
+    if(filled == 0) return 0;
+
+    float sum = 0;
+    for(int i = 0; i < filled; i++) sum += window[i];
+    return sum / filled;
+}
+
+float LightSensor::median() const
+{
+    if(filled == 0) return 0;
+
+    // Insertion sort a copy, the window is tiny
+    float sorted[LIGHT_WINDOW];
+    for(int i = 0; i < filled; i++)
+    {
+        float value = window[i];
+        int j = i;
+        while(j > 0 && sorted[j - 1] > value)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    return sorted[filled / 2];
+}
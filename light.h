@@ -0,0 +1,69 @@
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include "trace.h"
+#include "scheduler.h"
+
+#define LIGHT_OVERSAMPLE 4 // reads averaged into every sample
+#define LIGHT_WINDOW 7 // samples in the moving median and mean
+
+// Wald's sequential probability ratio test: is a signal sitting at mean0 or
+// at mean1, given gaussian noise? Every sample adds its log likelihood ratio
+// and we stop as soon as the total says one of them strongly enough. alpha
+// and beta are the chances of calling it wrong either way. Each sample's
+// share is capped so no single glitch can decide it.
+class SequentialTest
+{
+public:
+    SequentialTest(float mean0, float mean1, float noise, float alpha, float beta, float maxStep);
+
+    // Forget the evidence so far
+    void reset();
+
+    // Add a sample, returns 1 once it's surely mean1, -1 once it's surely
+    // mean0 and 0 while we can't tell yet
+    int add(float x);
+
+    // Samples since the last reset
+    int samples() const { return count; }
+
+private:
+    float mean0, mean1;
+    float variance;
+    float upper, lower;
+    float maxStep;
+    float total;
+    int count;
+};
+
+// Samples the CdS cell every tick, averaging a few reads each time, and keeps
+// a short window for a median and mean. The cell reads lower in light, drop()
+// is how far below the no-light baseline the last sample is.
+class LightSensor : public Task
+{
+public:
+    LightSensor(TracedAnalogPin &pin);
+
+    bool update();
+
+    // Latest oversampled reading in volts
+    float latest() const { return window[(next + LIGHT_WINDOW - 1) % LIGHT_WINDOW]; }
+
+    float mean() const;
+    float median() const;
+
+    // Remember what the cell reads with no light on it
+    void setBaseline() { baseline = median(); }
+    float base() const { return baseline; }
+
+    float drop() const { return baseline - latest(); }
+
+private:
+    TracedAnalogPin &pin;
+    float window[LIGHT_WINDOW];
+    int next;
+    int filled;
+    float baseline;
+};
+
+#endif // LIGHT_H
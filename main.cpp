@@ -1,6 +1,5 @@
 // THINGS WE NEED TO DO:
 // - Implement RPS
-// - Timeout on function
 
 
 // Dependencies
@@ -10,786 +9,2519 @@
 #include <FEHWONKA.h>
 #include <FEHMotor.h>
 #include <cmath>
+#include <cstdlib>
+#include "scheduler.h"
+#include "pid.h"
+#include "motionprofile.h"
+#include "pose.h"
+#include "mission.h"
+#include "telemetry.h"
+#include "display.h"
+#include "encoders.h"
+#include "recovery.h"
+#include "course.h"
+#include "path.h"
+#include "calibration.h"
+#include "light.h"
+#include "trace.h"
+#include "tuning.h"
+#include "inputs.h"
+#include "planner.h"
+#include "stall.h"
+#include "pursuit.h"
+#include "battery.h"
+#include "fixed.h"
+#include "wheels.h"
 
 // Positioning and heading
-FEHWONKA RPS;
+TracedRPS RPS;
+
+// Motor that remembers the last percent it was given, so we know which way
+// the wheels are turning (the encoders only count up). Commands go into the
+// sensor trace too. With battery compensation a percent is what it would be
+// on a pack at the nominal voltage, the motor gets it scaled to the pack.
+class RobotMotor : public FEHMotor
+{
+public:
+    RobotMotor(FEHMotor::FEHMotorPort port) : FEHMotor(port), port(port), percent(0), direction(1), battery(0) {}
+
+    void SetPercent(float percent)
+    {
+        this->percent = percent;
+        if(percent > 0) direction = 1;
+        if(percent < 0) direction = -1;
+        refresh();
+    }
+
+    // Give the motor the last percent again, scaled to the pack as it is now
+    void refresh()
+    {
+        float output = battery && battery->known() ? battery->apply(percent) : percent;
+        sensorTrace.add(TRACE_MOTOR, port, output);
+        FEHMotor::SetPercent(output);
+    }
+
+    // Scale commands from now on, 0 to send them as they are
+    void compensate(const BatteryCompensation *battery) { this->battery = battery; }
+
+    void Stop()
+    {
+        percent = 0;
+        sensorTrace.add(TRACE_MOTOR, port, 0);
+        FEHMotor::Stop();
+    }
+
+    float Percent() const { return percent; }
+
+    // Which way we last drove the motor (it keeps rolling that way after a stop)
+    int Direction() const { return direction; }
+
+private:
+    int port;
+    float percent;
+    int direction;
+    const BatteryCompensation *battery;
+};
 
 // Motor ports
-FEHMotor leftMotor(FEHMotor::Motor0);
-FEHMotor rightMotor(FEHMotor::Motor1);
+RobotMotor leftMotor(FEHMotor::Motor0);
+RobotMotor rightMotor(FEHMotor::Motor1);
 
 // Lift motor
-FEHMotor liftMotor(FEHMotor::Motor3);
+RobotMotor liftMotor(FEHMotor::Motor3);
 
 // CdS cell on robot bottom
-AnalogInputPin cds(FEHIO::P0_0);
+TracedAnalogPin cds(FEHIO::P0_0);
 
 // Declare shaft encoders
-FEHEncoder leftEncoder(FEHIO::P1_0);
-FEHEncoder rightEncoder(FEHIO::P0_2);
-FEHEncoder liftEncoder(FEHIO::P1_4);
+TracedEncoder leftEncoder(FEHIO::P1_0);
+TracedEncoder rightEncoder(FEHIO::P0_2);
+TracedEncoder liftEncoder(FEHIO::P1_4);
 
 // Digital microswitch for lift
-DigitalInputPin liftBottomSwitch (FEHIO::P2_0);
-DigitalInputPin backButtonRight (FEHIO::P2_2);
-DigitalInputPin backButtonLeft (FEHIO::P2_1);
-
+TracedDigitalPin liftBottomSwitch (FEHIO::P2_0);
+TracedDigitalPin backButtonRight (FEHIO::P2_2);
+TracedDigitalPin backButtonLeft (FEHIO::P2_1);
 
+// Button board
+TracedButtons buttons(FEHIO::Bank3);
 
-// ***************************ROBOT SETTINGS**************************
-
-#define BREAKTIME .3
+// Pack voltage
+TracedBattery battery;
 
-// CdS cell
-#define CDS_THRESHOLD 0.3
 
-// Motor speeds
-#define LEFT_MOTOR_SPEED_HI 80
-#define RIGHT_MOTOR_SPEED_HI 80
 
-#define LEFT_MOTOR_SPEED_MID 59
-#define RIGHT_MOTOR_SPEED_MID 60
+// ***************************ROBOT SETTINGS**************************
 
-#define LEFT_MOTOR_SPEED_LO 55 // PREVIOUSLY 55
-#define RIGHT_MOTOR_SPEED_LO 55
+// The drive speeds, accelerations, stop lead, break time, squaring and
+// corner radius are the tuned settings in tuning.h
+
+// CdS cell, drops are how far a light brings the reading below no light
+#define CDS_NOISE 0.05 // volts on one oversampled reading
+#define CDS_START_DROP 0.6 // start light
+#define CDS_RED_DROP 1.5
+#define CDS_BLUE_DROP 0.5
+#define CDS_FIND_DROP 0.2 // enough to say we are over the counter light
+#define CDS_CONFIDENCE 0.001 // chance of calling it wrong
+#define CDS_MAX_EVIDENCE 3.0 // most one sample can count for (the tests need about 7)
+#define CDS_START_TIMEOUT 30.0
+#define CDS_COLOR_TIMEOUT 1.5
+
+// Battery, speeds and timings hold on any pack when commands are scaled to it
+#define BATTERY_COMPENSATION 1
+#define BATTERY_NOMINAL 11.5 // volts the settings were tuned at
+#define BATTERY_PERIOD .1 // seconds between reads of the pack
 
 // Lift motor
 #define LIFT_SPEED_UP 40
 #define LIFT_SPEED_DOWN 45
 
+// Lift heights in counts above the bottom switch
+#define LIFT_COUNTS_OFF_FLOOR 2
 #define LIFT_COUNTS_TO_MIDDLE 4
 #define LIFT_COUNTS_TO_TOP 10
+#define LIFT_COUNTS_TO_DUMP 15
+#define LIFT_HOME_TIMEOUT 2.0 // lowering this long without the switch closing means we're down
+#define LIFT_SECONDS_PER_COUNT .2 // slowest the lift should move
+#define LIFT_MOVE_SLACK 1.0 // seconds a move may run over before the lift stops itself
+#define LIFT_DEADLINE 2.0 // seconds past that before a blocking wait gives up
+#define LIFT_STOP_LEAD .04 // seconds the lift keeps turning after we cut the motor
+#define LIFT_STALL_STARTUP .5 // seconds to get the first two counts in before it can be jammed
+
+// Encoder settings (until the robot has been calibrated), the counts per
+// wheel and per pivot are in wheels.h
+#define ENCODER_LOW_THRESHOLD 0.388
+#define ENCODER_HIGH_THRESHOLD 1.547
+#define LIFT_LOW_THRESHOLD 1.1
+#define LIFT_HIGH_THRESHOLD 1.8
 
-// Encoder settings
-#define COUNTS_PER_WHEEL 32.0
-#define WHEEL_CIRCUMFERENCE 2.75 * 3.14159
-
-#define COUNTS_TO_PIVOT 19
 #define EXTRA_TURN_TIME 0
 
 #define ENCODER_CORRECT 0
 
+// Wheel speed control (until the robot has been calibrated)
+#define COUNTS_PER_SEC_PER_PERCENT 0.6 // wheel speed in counts per second for every motor percent
+#define MOTOR_DEADBAND 0 // percent it takes to get a wheel turning
+
+// The wheel PID gains are in wheels.h. Fixed point runs the PID's own math on
+// integers to check it keeps up with float, the speeds still go in and out as
+// floats every tick so it saves no time yet.
+#define FIXED_POINT_WHEELS 0
+
+#define SYNC_KP 4.0 // counts per second of correction for every count the wheels are apart
+
+// Motion profiles
+#define MIN_WHEEL_SPEED 8 // counts per second we never go below until the target is reached
+
+// Driving along planned paths
+#define PATH_MIN_RADIUS (wheelBase() / 2) // any tighter and the inside wheel would have to back up
+#define PATH_CLEARANCE 2.0 // inches from the middle of the robot to any wall
+#define POSITION_KNOWN_VARIANCE 4 // square inches, below this we trust where we are on the map
+
+// Steering routes in course coordinates on the pose (pure pursuit) once we
+// know where we are. Routes laid out relative to the robot keep counting
+// wheel turns, they were tuned that way.
+#define PATH_PURSUIT 1
+#define PURSUIT_LOOKAHEAD 6.0 // inches, shorter hugs the line but weaves more
+#define PURSUIT_SPACING 1.0 // inches between the points a path is cut into
+#define PURSUIT_MAX_CURVE 0.9 // sharpest we steer, 1 would stop the inside wheel
+
+// Pose estimate
+#define RPS_PERIOD .1 // seconds between RPS fixes we blend in
+
+// Turning onto a heading
+#define HEADING_KP 1.2 // percent per degree off
+#define HEADING_KD 0.05
+#define MIN_TURN_PERCENT 22 // anything less doesn't turn the robot
+#define MAX_TURN_PERCENT 60
+#define HEADING_TOLERANCE 2.0 // degrees
+#define HEADING_SETTLE_TIME .1
+#define TURN_TIMEOUT 3.0 // give up on the heading after this long
+#define HEADING_KNOWN_VARIANCE 25 // square degrees, below this we trust the heading
+
+// Squaring up on a wall with the back switches
+#define SQUARE_RAMP_PERCENT 78 // enough to back up the ramp
+#define RESQUARE_PERCENT 50 // swinging the open side out and back in
+
+// Swinging on one wheel, counts are on the wheel that turns
+#define SWING_DEADLINE .5 // seconds a swing may run over before it ends where it is
+#define LINE_UP_SWING_COUNTS 8 // kicking the back out while lining up along a wall
+#define RAMP_SWING_COUNTS 27 // right side back when reversing onto the ramp wall stalls
+
+// Deadlines and getting unstuck
+#define MOVE_DEADLINE_SLACK 1.0 // seconds a drive or pivot may run over its planned time
+#define WALL_DEADLINE 8.0 // seconds to back into a wall
+#define RAMP_DEADLINE 5.0 // seconds to back up the ramp or into the charger
+#define WIGGLE_PERCENT 60
+#define WIGGLE_TIME .1 // seconds per push
+#define WIGGLE_PUSHES 4 // keep it even so we end up pushing the way we were going
+#define BACK_OFF_PERCENT 40
+#define BACK_OFF_TIME .3
+
+// Optional objectives at the end of the course, only done if they fit in
+// the time left
+#define COURSE_TIME_LIMIT 120.0 // seconds from the start light
+#define PLAN_MARGIN 5.0 // seconds kept back in case the estimates are short
+#define OVEN_POINTS 8 // for pressing as many times as the oven asks, nothing for fewer
+#define OVEN_MAX_PRESSES 3
+#define OVEN_GUESS 15.0 // seconds to the oven, one press and back out
+#define CHARGER_POINTS 8
+#define CHARGER_GUESS 6.0 // seconds to drive to the charger and back in
+
+// Calibration mode
+#define CAL_DRIVE_PERCENT 40
+#define CAL_DRIVE_COUNTS 100 // how far out from the wall to drive for the distance scale
+#define CAL_PIVOT_PERCENT 35
+#define CAL_PIVOT_TURNS 2 // more turns average out the RPS lag
+#define CAL_SETTLE_TIME .5 // seconds for a motor to get up to speed before we measure
+#define CAL_MEASURE_TIME 1.0
+#define CAL_RPS_WAIT .3 // seconds to let the robot stop and RPS catch up
+#define CAL_TIMEOUT 15.0
+
+// Telemetry
+#define TELEMETRY_PERIOD .06 // seconds between records of the whole run, the buffer holds just over two minutes
+
+// Screen layout while running
+#define ROW_STEP 0
+#define ROW_TIME 1
+#define ROW_X 2
+#define ROW_Y 3
+#define ROW_HEADING 4
+#define ROW_LEFT 5
+#define ROW_RIGHT 6
+#define ROW_CDS 7
+#define ROW_STATUS 8
+
 
 
 // ***********************FUNCTIONS*************************************
 
 
-// Reset the shaft encoders
-void resetEncoders()
+// Measured settings, the profile on the SD card replaces these at startup
+Calibration calibration = {
+    4 * COUNTS_TO_PIVOT,
+    (WHEEL_CIRCUMFERENCE) / COUNTS_PER_WHEEL,
+    COUNTS_PER_SEC_PER_PERCENT,
+    COUNTS_PER_SEC_PER_PERCENT,
+    MOTOR_DEADBAND,
+    MOTOR_DEADBAND,
+    ENCODER_LOW_THRESHOLD,
+    ENCODER_HIGH_THRESHOLD,
+    LIFT_LOW_THRESHOLD,
+    LIFT_HIGH_THRESHOLD,
+};
+
+// Speeds and timings, host/robot-tune can pick better ones for TUNING_FILE
+Tuning tuning = TUNING_DEFAULTS;
+
+// Distance between the wheels, each one rolls once around the circle between
+// them in a full pivot
+float wheelBase()
 {
-    leftEncoder.ResetCounts();
-    rightEncoder.ResetCounts();
-    liftEncoder.ResetCounts();
+    return calibration.countsPerTurn * calibration.inchesPerCount / 3.14159;
 }
 
-// Stop moving robot
-void stop()
+// Motor percent that should turn a wheel at a speed in counts per second
+float feedForward(float speed, float gain, float deadband)
 {
-    // Set both motors to 0 percent speed
-    leftMotor.SetPercent(0);
-    rightMotor.SetPercent(0);
+    if(speed <= 0) return 0;
+    return deadband + speed / gain;
 }
 
-// Drive both directions
-void drive(float distance, int direction)
+float leftFeedForward(float speed) { return feedForward(speed, calibration.leftGain, calibration.leftDeadband); }
+float rightFeedForward(float speed) { return feedForward(speed, calibration.rightGain, calibration.rightDeadband); }
+
+// Speed both wheels can make at a motor percent
+float wheelSpeedAt(float percent)
 {
-    // Reset the encoders
-    resetEncoders();
+    float left = (percent - calibration.leftDeadband) * calibration.leftGain;
+    float right = (percent - calibration.rightDeadband) * calibration.rightGain;
+    return left < right ? left : right;
+}
 
-    float distancePerCount = WHEEL_CIRCUMFERENCE / COUNTS_PER_WHEEL;
+// The CdS cell, filtered and sampled once a tick
+LightSensor light(cds);
 
+// Every encoder is read once a tick through these, which also know when each
+// count came in and how fast the shaft is turning
+EncoderSampler leftWheel(leftEncoder);
+EncoderSampler rightWheel(rightEncoder);
+EncoderSampler liftShaft(liftEncoder);
 
-    // Calculations for distance
-    int numberOfCounts = std::floor(distance / distancePerCount) - ENCODER_CORRECT;
+// The switches and the stop button as they were at the start of the tick.
+// Everything reads these instead of the pins, so a tick sees one consistent
+// set of values and edges come with the time they were seen.
+struct InputSnapshot
+{
+    double time; // when they were read
+    DebouncedInput backLeft;
+    DebouncedInput backRight;
+    DebouncedInput liftBottom;
+    DebouncedInput stopButton; // left button
+};
 
+InputSnapshot inputs;
 
-    // Set the motor speed percentages to medium and direction
-    leftMotor.SetPercent(LEFT_MOTOR_SPEED_LO * direction);
-    rightMotor.SetPercent(RIGHT_MOTOR_SPEED_LO * direction);
+// Back switch closing to the wheels answering it
+ReactionTimer bumpReaction;
 
-    // Drive specified number of counts
-    while(leftEncoder.Counts() <= numberOfCounts && rightEncoder.Counts() <= numberOfCounts){
-        LCD.WriteLine(leftEncoder.Counts());
-        LCD.WriteLine(rightEncoder.Counts());
+// Reads the encoders and switches once, runs first every tick
+class InputTask : public Task
+{
+public:
+    bool update()
+    {
+        double now = TimeNow();
+        inputs.time = now;
+        sensorTrace.startTick(now);
+        leftWheel.sample(now);
+        rightWheel.sample(now);
+        liftShaft.sample(now);
+
+        // Switches read 0 when pressed
+        inputs.backLeft.sample(backButtonLeft.Value() == 0, now);
+        inputs.backRight.sample(backButtonRight.Value() == 0, now);
+        inputs.liftBottom.sample(liftBottomSwitch.Value() == 0, now);
+        inputs.stopButton.sample(buttons.LeftPressed(), now);
+        return false;
     }
+};
 
-    // Stop the motors
-    stop();
-}
+InputTask inputTask;
 
-// Readable function names for driving
-void driveForward(double distance) {
-    if(distance > 0)
-    {
-        // Distance is specified
-        drive(distance, 1);
-    }
-    else
-    {
-        // Drive continuously
-        leftMotor.SetPercent(LEFT_MOTOR_SPEED_LO);
-        rightMotor.SetPercent(RIGHT_MOTOR_SPEED_LO);
-    }
-}
-void driveBackward(double distance) {
-    if(distance > 0)
-    {
-        drive(distance, -1);
-    }
-    else
-    {
-        // Drive continuously
-        leftMotor.SetPercent(-1 * LEFT_MOTOR_SPEED_LO);
-        rightMotor.SetPercent(-1 * RIGHT_MOTOR_SPEED_LO);
-    }
-}
+// Motor commands scaled to the pack
+BatteryCompensation compensation(BATTERY_NOMINAL);
 
-// Pivot the robot in place
-void pivot(int direction, int correction = 0)
+// Reads the pack a few times a second and gives the motors the new scale
+class BatteryTask : public Task
 {
-    // Reset the encoders
-    resetEncoders();
+public:
+    BatteryTask() : lastRead(-BATTERY_PERIOD) {}
 
-    // Check which direction to pivot
-    if(direction > 0)
-    {
-        // TURN LEFT - set motor speeds and directions
-        leftMotor.SetPercent(LEFT_MOTOR_SPEED_LO * -1);
-        rightMotor.SetPercent(RIGHT_MOTOR_SPEED_LO);
-    }
-    else
+    bool update()
     {
-        // TURN RIGHT - set motor speeds and directions
-        leftMotor.SetPercent(LEFT_MOTOR_SPEED_LO);
-        rightMotor.SetPercent(RIGHT_MOTOR_SPEED_LO * -1);
+        double now = TimeNow();
+        if(now - lastRead < BATTERY_PERIOD) return false;
+        lastRead = now;
+
+        compensation.update(battery.Voltage(), now);
+        leftMotor.refresh();
+        rightMotor.refresh();
+        liftMotor.refresh();
+        return false;
     }
 
-    // Wait for proper number of encoder counts
-    while(leftEncoder.Counts() <= (COUNTS_TO_PIVOT + correction) && rightEncoder.Counts() <= (COUNTS_TO_PIVOT + correction));
-
-    if(direction==0)
-    Sleep(EXTRA_TURN_TIME);
-
-    // Stop turning
-    stop();
-}
+private:
+    double lastRead;
+};
 
-// Readable function names for pivoting
-void pivotRightTurn() { pivot(0); }
-void pivotLeftTurn() { pivot(1); }
+BatteryTask batteryTask;
 
-//---------------------------------RPS Methods experimential-------------------------------------------------------
+// Each one watches a motor against its encoder for a jam
+StallDetector leftStall;
+StallDetector rightStall;
+StallDetector liftStall(LIFT_STALL_STARTUP);
 
-int isCloseTo(double a, double b)
+// Counts per second a wheel should turn at for a motor percent, signed like the percent
+float expectedWheelSpeed(float percent, float deadband, float gain)
 {
-    if (std::abs(a - b) < 4) return 1;
-    return 0;
+    float speed = (std::fabs(percent) - deadband) * gain;
+    if(speed <= 0) return 0;
+    return percent < 0 ? -speed : speed;
 }
 
-// Pivot the robot in place
-void pivotRPS(int direction)
+// Checks the motors against the encoders every tick, right after they're read
+class StallTask : public Task
 {
-    // Reset the encoders
-    resetEncoders();
-
-    double startHeading = RPS.Heading();
-    pivot(direction);
-    if (startHeading != 0 && RPS.Heading() != 0) {
-        LCD.WriteLine(RPS.Heading());
-
+public:
+    bool update()
+    {
+        double now = TimeNow();
+        leftStall.update(expectedWheelSpeed(leftMotor.Percent(), calibration.leftDeadband, calibration.leftGain),
+                         leftWheel.speed(), now);
+        rightStall.update(expectedWheelSpeed(rightMotor.Percent(), calibration.rightDeadband, calibration.rightGain),
+                          rightWheel.speed(), now);
+
+        // The lift's slowest is one count every LIFT_SECONDS_PER_COUNT
+        float lift = liftMotor.Percent();
+        liftStall.update(lift == 0 ? 0 : (lift > 0 ? 1 : -1) / LIFT_SECONDS_PER_COUNT, liftShaft.speed(), now);
+        return false;
+    }
+};
 
-            if (startHeading < 90) {
-                startHeading += 90;
-            } else {
-                startHeading -= 90;
-            }
+StallTask stallTask;
 
-            // Turn
-            while(!isCloseTo((double)(startHeading), (double)(RPS.Heading()))) {
-                if (RPS.Heading() > startHeading) {
-                    leftMotor.SetPercent(-40);
-                    rightMotor.SetPercent(40);
-                    Sleep(.2);
-                    stop();
-                } else {
-                    leftMotor.SetPercent(40);
-                    rightMotor.SetPercent(-40);
-                    Sleep(.2);
-                    stop();
-                }
-            }
-    }
-    stop();
+// Either drive wheel jammed
+bool wheelsStalled()
+{
+    return leftStall.stalled() || rightStall.stalled();
 }
 
+// Where we think we are, kept up to date every tick
+PoseEstimator pose;
 
-//void closestQuarter(float heading)
-//{
+// Drive encoder counts odometry has already used
+int odometryLeftCounts = 0;
+int odometryRightCounts = 0;
 
-//}
+// Counts from both wheels since power on, never reset
+long odometryTravel = 0;
 
+// Dead reckon any new encoder counts into the pose
+void updateOdometry()
+{
+    int left = leftWheel.counts();
+    int right = rightWheel.counts();
 
-//void checkHeading()
-//{
-// float heading = RPS.Heading();
+    float distancePerCount = calibration.inchesPerCount;
+    float leftDistance = (left - odometryLeftCounts) * distancePerCount;
+    float rightDistance = (right - odometryRightCounts) * distancePerCount;
 
-// if()
-//}
+    // The encoders only count up, the motor tells us which way they went
+    leftDistance *= leftMotor.Direction();
+    rightDistance *= rightMotor.Direction();
 
+    pose.addOdometry(leftDistance, rightDistance, wheelBase());
+    odometryTravel += (left - odometryLeftCounts) + (right - odometryRightCounts);
+    odometryLeftCounts = left;
+    odometryRightCounts = right;
+}
 
+// Whether an RPS read is a fix. Without one it gives zeros, or -1 or so when
+// it can't see the robot at all.
+bool rpsFix(float x, float y)
+{
+    return x >= 0 && y >= 0 && (x != 0 || y != 0);
+}
 
+// Runs every tick: odometry always, RPS whenever there is a new fix
+class PoseTask : public Task
+{
+public:
+    void start()
+    {
+        lastFixTime = 0;
+        lastX = lastY = lastHeading = 0;
+        lastTravel = 0;
+    }
 
-// Readable function names for pivoting
-void pivotRightTurnRPS() { pivot(0); }
-void pivotLeftTurnRPS() { pivot(1); }
+    bool update()
+    {
+        updateOdometry();
+
+        if(TimeNow() - lastFixTime < RPS_PERIOD) return false;
+        lastFixTime = TimeNow();
+
+        float x = RPS.X();
+        float y = RPS.Y();
+        float heading = RPS.Heading();
+
+        // RPS gives the same numbers over and over between updates (only
+        // blend each fix in once). The same numbers after the wheels have
+        // turned are news though, the robot is stuck where it was and
+        // odometry has it somewhere else.
+        if(!rpsFix(x, y)) return false;
+        if(x == lastX && y == lastY && heading == lastHeading && odometryTravel == lastTravel) return false;
+
+        lastX = x;
+        lastY = y;
+        lastHeading = heading;
+        lastTravel = odometryTravel;
+        pose.addFix(x, y, heading);
+        return false;
+    }
 
+private:
+    double lastFixTime;
+    float lastX, lastY, lastHeading;
+    long lastTravel;
+};
 
+PoseTask poseTask;
 
-//-------------------------------End RPS ---------------------------------------------------------------------------
+// Reset the drive shaft encoders. The lift encoder is left alone so the
+// lift can keep moving while we drive.
+void resetEncoders()
+{
+    // Don't lose the counts odometry hasn't seen yet
+    double now = TimeNow();
+    leftWheel.sample(now);
+    rightWheel.sample(now);
+    updateOdometry();
+
+    leftWheel.reset();
+    rightWheel.reset();
+    odometryLeftCounts = 0;
+    odometryRightCounts = 0;
+}
 
+// Stop moving robot
+void stop()
+{
+    // Set both motors to 0 percent speed
+    leftMotor.SetPercent(0);
+    rightMotor.SetPercent(0);
+}
 
-// Set the lift height
-void liftHeight(int clicks)
+// Wait without starving the background tasks (use instead of Sleep)
+void delay(double seconds)
 {
-    ButtonBoard buttons(FEHIO::Bank3);
+    scheduler.sleep(seconds);
+}
 
-    // Reset the encoders
-    resetEncoders();
-    int startMeUp = TimeNow();
-    if(clicks < 1)
+// Rock back and forth along whatever move we got stuck on to shake loose
+class WiggleTask : public Task
+{
+public:
+    void start()
     {
-        liftMotor.SetPercent(LIFT_SPEED_DOWN);
-        while(liftBottomSwitch.Value() > 0&&TimeNow()-startMeUp<2.0);
-        liftMotor.SetPercent(0);
-
-        resetEncoders();
+        // The motors remember which way they were going before the stop
+        leftSign = leftMotor.Direction();
+        rightSign = rightMotor.Direction();
+        pushes = 0;
+        display.set(ROW_STATUS, "Wiggle");
+        push();
     }
-    else
-    {
-        liftHeight(0);
 
-        liftMotor.SetPercent(LIFT_SPEED_UP*-1);
+    bool update()
+    {
+        if(TimeNow() - pushStart < WIGGLE_TIME) return false;
+        if(++pushes >= WIGGLE_PUSHES) return true;
 
-        // Move for number of counts
-        while(liftEncoder.Counts() <= clicks && TimeNow()-startMeUp<(clicks*.2))
-        {
-            if(buttons.LeftPressed()) break;
-            //LCD.WriteLine(liftSensor.Value());
+        push();
+        return false;
+    }
 
-        }
+    void finish()
+    {
+        stop();
+    }
 
-        // Stop moving
-        liftMotor.SetPercent(0);
+private:
+    // Back the way we came first, then on the way we were going
+    void push()
+    {
+        int sign = pushes % 2 == 0 ? -1 : 1;
+        leftMotor.SetPercent(sign * leftSign * WIGGLE_PERCENT);
+        rightMotor.SetPercent(sign * rightSign * WIGGLE_PERCENT);
+        pushStart = TimeNow();
     }
-}
 
-// Back up until both sensors are hitting the wall
-void reverseToWall()
+    int leftSign, rightSign;
+    int pushes;
+    double pushStart;
+};
+
+WiggleTask wiggleTask;
+
+// Back away from whatever move we got stuck on
+class BackOffTask : public Task
 {
-    driveBackward(0);
-    while(backButtonRight.Value() == 1 && backButtonLeft.Value() == 1) {
+public:
+    void start()
+    {
+        display.set(ROW_STATUS, "Back off");
+        leftMotor.SetPercent(-leftMotor.Direction() * BACK_OFF_PERCENT);
+        rightMotor.SetPercent(-rightMotor.Direction() * BACK_OFF_PERCENT);
+        startTime = TimeNow();
     }
-    Sleep(.6);
-    stop();
-}
 
-void reverseToWallBoth()
-{
-    driveBackward(0);
-    while(backButtonRight.Value() == 1 && backButtonLeft.Value() == 1) {
+    bool update()
+    {
+        return TimeNow() - startTime >= BACK_OFF_TIME;
     }
-    Sleep(.9);
-    stop();
-}
 
+    void finish()
+    {
+        stop();
+    }
 
-void reverseToWallHigh()
+private:
+    double startTime;
+};
+
+BackOffTask backOffTask;
+
+// What each kind of wait does when it runs out of time. A stuck drive or
+// pivot gets a wiggle then a back off, as soon as a wheel jams rather than
+// at the deadline. Backing into a wall that only one switch finds gets
+// backed off from twice (the wheels stall on the wall by design there).
+// Anything else is skipped.
+WaitPlan movePlan = { MOVE_DEADLINE_SLACK, { &wiggleTask, &backOffTask }, wheelsStalled };
+WaitPlan wallPlan = { WALL_DEADLINE, { &backOffTask, &backOffTask } };
+WaitPlan rampPlan = { RAMP_DEADLINE, { 0 } };
+WaitPlan turnPlan = { TURN_TIMEOUT, { 0 } };
+WaitPlan swingPlan = { SWING_DEADLINE, { 0 } };
+
+// The mission table and the optional objectives are further down
+extern Mission course;
+extern Planner planner;
+extern Telemetry tickTelemetry;
+
+// Moves skipped this run because nothing in their plan got them done
+int givenUp = 0;
+
+// Run a blocking task under the running step's plan if it has one, otherwise
+// under the one given. Never hangs, it skips the task when all else fails.
+void runPlanned(Task *task, const WaitPlan &plan)
 {
-    leftMotor.SetPercent(-78); rightMotor.SetPercent(-78);
-    while(backButtonRight.Value() == 1 && backButtonLeft.Value() == 1) {
+    const Step *optional = planner.currentStep();
+    const WaitPlan *stepPlan = optional ? optional->plan : course.currentPlan();
+    if(!waitFor(task, stepPlan ? *stepPlan : plan))
+    {
+        display.set(ROW_STATUS, "Gave up");
+        givenUp++;
+
+        // Keep the ticks that led up to it
+        tickTelemetry.hold();
     }
-    Sleep(.5);
-    stop();
 }
 
-void takeBreak()
-{
-    Sleep(BREAKTIME);
-}
-//End functions
+// The wheel PID. Fixed point does the same with integers inside, but the
+// float conversions on the way in and out cost as much as they save.
+#if FIXED_POINT_WHEELS
+typedef FixedPID WheelPID;
+#else
+typedef PID WheelPID;
+#endif
 
-//---------------------------------------------------------------------------------------------------------
+// Holds both drive wheels at a target speed and keeps their counts together
+class WheelControl
+{
+public:
+    WheelControl()
+        : leftPID(WHEEL_KP, WHEEL_KI, WHEEL_KD, -WHEEL_CORRECTION_MAX, WHEEL_CORRECTION_MAX),
+          rightPID(WHEEL_KP, WHEEL_KI, WHEEL_KD, -WHEEL_CORRECTION_MAX, WHEEL_CORRECTION_MAX)
+    {
+    }
 
-//START MAIN
+    // Start a move, the signs give each wheel's direction
+    void start(int leftSign, int rightSign)
+    {
+        this->leftSign = leftSign;
+        this->rightSign = rightSign;
+        lastTime = TimeNow();
+        leftPID.reset();
+        rightPID.reset();
+    }
 
-// Main function
-int main(void)
-{
-    ButtonBoard buttons(FEHIO::Bank3);
+    // Run one tick of control toward a speed in counts per second. On a curve
+    // the left wheel runs at 1 - curve times the speed and the right one at
+    // 1 + curve, and lead is how many counts the left wheel should be ahead.
+    void update(float target, float curve = 0, float lead = 0)
+    {
+        double now = TimeNow();
 
-    //Declare variables
-    double nolight;
-    int blue;
-    int parity;
-    double startTime;
+        // Slow down whichever wheel is ahead and speed up the other one
+        float ahead = leftWheel.position(now) - rightWheel.position(now) - lead;
+        drive(target * (1 - curve) - SYNC_KP * ahead, target * (1 + curve) + SYNC_KP * ahead);
+    }
 
-    // Configure shaft encoders
-    float lowThreshold = 0.388;
-    float highThreshold = 1.547;
+    // Same without holding the wheels' counts together, for when something
+    // watching the pose does the steering
+    void steer(float target, float curve)
+    {
+        drive(target * (1 - curve), target * (1 + curve));
+    }
 
-    float lowThresholdLift = 1.1;
-    float highThresholdLift = 1.8;
+private:
+    void drive(float leftTarget, float rightTarget)
+    {
+        double now = TimeNow();
+        float dt = now - lastTime;
+        lastTime = now;
 
-    leftEncoder.SetThresholds(lowThreshold, highThreshold);
-    rightEncoder.SetThresholds(lowThreshold, highThreshold);
-    liftEncoder.SetThresholds(lowThresholdLift, highThresholdLift);
+        // Feed forward the expected percent and let the PID fix the rest
+        float leftPercent = leftFeedForward(leftTarget) + leftPID.update(leftTarget - leftWheel.speed(), dt);
+        float rightPercent = rightFeedForward(rightTarget) + rightPID.update(rightTarget - rightWheel.speed(), dt);
 
-    // Reset screen
-    LCD.Clear(FEHLCD::Black);
-    LCD.SetFontColor(FEHLCD::White);
+        leftMotor.SetPercent(clampPercent(leftPercent) * leftSign);
+        rightMotor.SetPercent(clampPercent(rightPercent) * rightSign);
+    }
 
-    // Initialize the positioning system
-     RPS.InitializeMenu();
-     RPS.Enable();
+    float clampPercent(float percent)
+    {
+        if(percent > 100) return 100;
+        if(percent < 0) return 0;
+        return percent;
+    }
 
+    WheelPID leftPID, rightPID;
+    int leftSign, rightSign;
+    double lastTime;
+};
 
+WheelControl wheels;
 
+// Drive a set distance in either direction
+class DriveTask : public Task
+{
+public:
+    void set(float distance, int direction)
+    {
+        this->distance = distance;
+        this->direction = direction;
+        resuming = false;
+    }
 
-    //The program goes for the objectives in this order: pin, skid, read light, drop skid, drop scoop, flip switch, BUTTON NEEDS IMPLEMENTATION, Charger
-    //
-    // SPACE FOR ERROR LOGGING AND NOTES
-    //
-    //
-    //
-    // Main program loop
-    while(true)
+    void start()
     {
-        // Wait for the left button to be pressed before starting
-        while(!buttons.MiddlePressed());
-        while(buttons.MiddlePressed());
-        //goto segment4;
-
-//        while( true )
-//        {
-//            if( buttons.MiddlePressed() )
-//            {
-//                while(buttons.MiddlePressed());
-//                LCD.WriteLine(cds.Value());
-//            }
-//        }
-//        return 0;
-
-        //SEgment one will pick up the skid
-        //segment1:
-            //liftHeight(2);
-        liftHeight(0);
-        liftMotor.SetPercent(-40);
-        Sleep(.5);
-        liftMotor.Stop();
-
-            // Move into waitForCdS()
-            nolight = cds.Value(); //Wait for the light
-
-            double startTime = TimeNow();
-            while((std::abs(nolight - cds.Value()) < CDS_THRESHOLD) && (TimeNow() - startTime < 30)) {
-                LCD.WriteLine(cds.Value());
-            }
+        // Reset the encoders
+        resetEncoders();
 
-            double veryStart = TimeNow();
+        float left = distance;
+        if(resuming)
+        {
+            // Only go what's left, measured along the way we set off
+            float angle = startHeading * 3.14159 / 180;
+            float along = (pose.x() - startX) * std::cos(angle) + (pose.y() - startY) * std::sin(angle);
+            left = distance - direction * along;
+            if(left < 0) left = 0;
+        }
+        else
+        {
+            startX = pose.x();
+            startY = pose.y();
+            startHeading = pose.heading();
+        }
+        resuming = false;
 
+        float distancePerCount = calibration.inchesPerCount;
 
-            // Drive to in front of the skid Step 1
-            driveForward(35.0);
-            // RPS CHECK X
+        // Calculations for distance
+        numberOfCounts = std::floor(left / distancePerCount) - ENCODER_CORRECT;
 
-            //Turn and use the opposite skid wall as a lining up tool
-            pivotLeftTurn();
-            reverseToWall();
+        // Ramp up to high speed and back down onto the last count
+        profile.plan(numberOfCounts + 1, wheelSpeedAt(tuning.speedHigh), tuning.driveAccel, MIN_WHEEL_SPEED);
+        startTime = TimeNow();
 
-            startTime = TimeNow();
-            while(TimeNow()-startTime<1.0) { //Line up Set distance from pin
-                if(backButtonLeft.Value() == 1 && backButtonRight.Value() == 0) { Sleep(.8); stop(); break; }
-                else if(backButtonLeft.Value() == 1 && backButtonRight.Value() == 1) { driveBackward(0); LCD.WriteLine("WHY!"); }
-                else if(backButtonLeft.Value() == 0 && backButtonRight.Value() == 0) {
-                    LCD.WriteLine("DrivingLoop");
-                    driveForward(3);
-                    leftMotor.SetPercent(50); Sleep(.3);
-                    driveBackward(0);
-                    Sleep(.4);
-                }
-            }
+        // Both wheels go the same way
+        wheels.start(direction, direction);
+    }
 
+    bool update()
+    {
+        double now = TimeNow();
+        display.set(ROW_LEFT, "Left", leftWheel.counts());
+        display.set(ROW_RIGHT, "Right", rightWheel.counts());
+
+        // Done once the wheels will have gone the distance on average by the
+        // time they stop rolling
+        float stopping = (leftWheel.predict(now, tuning.stopLead) + rightWheel.predict(now, tuning.stopLead)) / 2;
+        if(stopping >= numberOfCounts + 1) return true;
+
+        // The speed controller keeps us straight so we can run at high speed
+        float travelled = (leftWheel.position(now) + rightWheel.position(now)) / 2;
+        wheels.update(profile.speed(now - startTime, travelled));
+        return false;
+    }
 
-            driveForward(1.5);
-            // CHECK RPS Y
-
-            pivotRightTurn();
-
-//            startTime = TimeNow();
-//            while(std::abs(RPS.Heading()-90)>7&&TimeNow()-startTime<5.0 )
-//            {
-//                if(RPS.Heading()>90)
-//                {
-//                    leftMotor.SetPercent(40);
-//                    rightMotor.SetPercent(-40);
-//                }
-//                else
-//                {
-//                    leftMotor.SetPercent(-40);
-//                    rightMotor.SetPercent(40);
-//                }
-//            }
-//            stop();
-            /**
-******************************
-*MIKE ADD CODE TO CHECK IF WE
-*ARE FACING EAST(90) TO GO
-*TOWARDS THE PIN*
-***********************************/
-
-
-
-            driveForward(5.0); //Should catch on the pipe
-            stop();
+    void finish()
+    {
+        // Stop the motors
+        stop();
+    }
 
-            leftMotor.SetPercent(40);
-            Sleep(0.2);
-            stop();
+    double expected() const
+    {
+        return profile.duration();
+    }
 
-            //Make sure we don't hit the tube the whole time
-            Sleep(.2);
-            driveBackward(0);
-            Sleep(.1);
-            stop();
+    void retry()
+    {
+        resuming = true;
+    }
 
-            //Pull the pin
-            liftMotor.SetPercent(-44); //from -50
-            Sleep(1.2); //From .87
-            driveBackward(2);
-            liftMotor.SetPercent(0);
-            takeBreak();
-            pivotLeftTurn();
+private:
+    float distance;
+    int direction;
+    int numberOfCounts;
+    bool resuming;
+    float startX, startY, startHeading;
+    MotionProfile profile;
+    double startTime;
+};
 
-            stop();
+DriveTask driveTask;
 
-            //Lower lift to help pick up skid
-            liftHeight(0);
-            Sleep(.3);
+// Drive both directions
+void drive(float distance, int direction)
+{
+    driveTask.set(distance, direction);
+    runPlanned(&driveTask, movePlan);
+}
 
-            //Back up to opposite skid wall to line up with skid
-            driveBackward(0);
-            startTime = TimeNow();
-            while(TimeNow()-startTime<4.0) { //Line up with the skid
-                if(backButtonLeft.Value() == 1 && backButtonRight.Value() == 0) { Sleep(.8); stop(); break; }
-                else if(backButtonLeft.Value() == 1 && backButtonRight.Value() == 1) { driveBackward(0); LCD.WriteLine("WHY!"); }
-                else if(backButtonLeft.Value() == 0 && backButtonRight.Value() == 0) {
-                    LCD.WriteLine("DrivingLoop");
-                    driveForward(2);
-                    leftMotor.SetPercent(60); Sleep(.3);
-                    driveBackward(0);
-                    Sleep(.4);
-                }
-            }
+// Run both wheels at low speed until told otherwise, each one at the
+// percent that matches it to the other
+void driveContinuous(int direction)
+{
+    float speed = wheelSpeedAt(tuning.speedLow);
+    leftMotor.SetPercent(direction * leftFeedForward(speed));
+    rightMotor.SetPercent(direction * rightFeedForward(speed));
+}
 
-            rightMotor.SetPercent(40); Sleep(.1); //was .2
-            rightMotor.SetPercent(0);
-
-            //Pick up skid step 6
-            driveForward(17);
-            liftMotor.SetPercent(-46);
-            takeBreak();
-
-            //Navigate to ramp and yada yada step 9
-            driveBackward(12);
-            liftMotor.SetPercent(0);
-            pivotLeftTurn();
-            /**
-******************************
-*MIKE ADD CODE TO CHECK IF WE
-*ARE FACING EAST(90) TO GO
-*TOWARDS THE CENTER OF THE COURSE BACKWARDS*
-***********************************/
-            stop();
-            driveForward(9); //Now in the center
-            takeBreak();
-
-            //pivot(0, -2); //Turn so as to go down ramp
-            pivot(1);
-
-            /**
-******************************
-*MIKE ADD CODE TO CHECK IF WE
-*ARE FACING SOUTH(0) TO GO
-*TOWARDS THE SWITCH BACKWARDS*
-***********************************/
-
-            driveBackward(-1);
-            //Reverse to wall and if stuck move the right motor back
-            startTime = TimeNow();
-            while(backButtonRight.Value() == 1 && backButtonLeft.Value() == 1)
-            {
-                if(TimeNow()-startTime>1) {stop(); rightMotor.SetPercent(-40); Sleep(1.4); stop(); break;}
-            }
+// Readable function names for driving
+void driveForward(double distance) {
+    if(distance > 0)
+    {
+        // Distance is specified
+        drive(distance, 1);
+    }
+    else
+    {
+        // Drive continuously
+        driveContinuous(1);
+    }
+}
+void driveBackward(double distance) {
+    if(distance > 0)
+    {
+        drive(distance, -1);
+    }
+    else
+    {
+        // Drive continuously
+        driveContinuous(-1);
+    }
+}
 
-            driveForward(4);
-            pivotRightTurn(); pivotRightTurn(); leftMotor.SetPercent(50); Sleep(.7); stop();
-
-            /**
-******************************
-*MIKE ADD CODE TO CHECK IF WE
-*ARE FACING NORTH(0) TO GO
-*DOWN THE RAMP BACKWARDS*
-***********************************/
-
-//            liftMotor.SetPercent(30);
-//            Sleep(.2);
-//            liftMotor.Stop();
-
-
-            //goto menu; //Segment 2 will Read the light
-
-//segment2:
-            Sleep(.2);
-            reverseToWall(); //Drive back until the counter is hit
-
-            parity = 1; //Find the light
-            nolight=cds.Value();
-            startTime = TimeNow();
-            while(std::abs(nolight - cds.Value()) < 0.2 && (TimeNow()-startTime)<3.0) {
-                if(parity) {
-                    driveForward(2);
-                    parity = 0;
-                } else {
-                    driveBackward(1);
-                    parity = 1;
-                }
-            }
+// Pivot the robot in place
+class PivotTask : public Task
+{
+public:
+    void set(int direction, int correction)
+    {
+        this->direction = direction;
+        this->correction = correction;
+        resuming = false;
+    }
 
-            blue = 0; //Determining the light color
-            startTime = TimeNow();
-            while(TimeNow() - startTime < 1.5) {
-                blue = cds.Value() < (nolight - 1) ? 0 : 1; //Look up ternary operator if this confuses you.
-            }
+    void start()
+    {
+        // Reset the encoders
+        resetEncoders();
+        turned = false;
 
-            if(blue) LCD.WriteLine("I'm blue :(");
-            else LCD.WriteLine("Red, the blood of angry men");
+        float quarter = calibration.countsPerTurn / 4;
+        counts = std::floor(quarter + .5) + correction;
+        if(resuming)
+        {
+            // Only turn what's left of the angle we set out to turn
+            float angle = 90.0 * counts / quarter;
+            float done = angleDifference(pose.heading(), startHeading) * (direction > 0 ? 1 : -1);
+            counts = std::floor((angle - done) * quarter / 90);
+            if(counts < 0) counts = 0;
+        }
+        else
+        {
+            startHeading = pose.heading();
+        }
+        resuming = false;
 
-            //Deposit skid step 19
-            reverseToWall(); //Back to the counter
+        // Ramp the turn up to high speed and back down onto the count
+        profile.plan(counts + 1, wheelSpeedAt(tuning.speedHigh), tuning.pivotAccel, MIN_WHEEL_SPEED);
+        startTime = TimeNow();
 
-//goto menu; //Deposit the skid in segment 3
-//segment3:
-            Sleep(.5);
-            driveForward(2);
-            pivotRightTurn();
-            reverseToWall();
+        // Check which direction to pivot
+        if(direction > 0)
+        {
+            // TURN LEFT - left wheel backward, right wheel forward
+            wheels.start(-1, 1);
+        }
+        else
+        {
+            // TURN RIGHT - left wheel forward, right wheel backward
+            wheels.start(1, -1);
+        }
+    }
 
-            //Check if we hit the chiller door and messed up that way
-            if(backButtonLeft.Value()==0&&backButtonRight.Value()==1)
+    bool update()
+    {
+        if(!turned)
+        {
+            // Wait for proper number of encoder counts (counting the roll
+            // after we stop)
+            double now = TimeNow();
+            float stopping = (leftWheel.predict(now, tuning.stopLead) + rightWheel.predict(now, tuning.stopLead)) / 2;
+            if(stopping < counts + 1)
             {
-                driveForward(2);
-                rightMotor.SetPercent(40);
-                Sleep(.2);
-                reverseToWall();
+                float travelled = (leftWheel.position(now) + rightWheel.position(now)) / 2;
+                wheels.update(profile.speed(now - startTime, travelled));
+                return false;
             }
 
-            driveForward(.5);
-            pivotLeftTurn(); //Now I'm facing the chiller
-            reverseToWall();
-
-            //Deposit skid in chiller step 28
-            driveForward(12);
-
-            liftHeight(0);
-
-            driveBackward(4);
-
-            //liftHeight(9);
-            liftMotor.SetPercent(-50);
-            Sleep(.9);
-            liftMotor.SetPercent(0);
-            driveForward(12);
-
-            //move to corner to begin scoop dropping step 33
-            reverseToWall(); //Skid is all good and we are on the opposite wall
-
-            //goto menu; //End segment3
-            //segment4:
-            Sleep(.3);
-
-            //Get to the front corner of the shop
-            driveForward(5);
-            pivotLeftTurn();
-            reverseToWall();
-            //Now corner check
-            driveForward(5);
-            pivotRightTurn();
-            reverseToWall();
-            //Get back to the correct wall
-            driveForward(3);
-            pivotLeftTurn();
-            reverseToWall();
-
-
-rightMotor.SetPercent(50);
-Sleep(.8); // prev 0.7
-driveForward(9);
-rightMotor.SetPercent(-50);
-Sleep(.95); // prev 0.75
-reverseToWall();
-
-            //deposit scoop step 37 CORNER
-            if(blue)
-            driveForward(5);
-            else driveForward(20);
-            liftHeight(15);
-            liftMotor.SetPercent(-80); Sleep(0.9); liftMotor.SetPercent(0);
-            reverseToWall();
-
-            liftHeight(0);
-
-            //Get away from corner step 40 CAN USE RPS TO FIND 90 DEGREES HERE
-
-            leftMotor.SetPercent(50);
-            Sleep(1.4);
-            driveForward(6);
-            leftMotor.SetPercent(-50);
-            Sleep(1.1);
-            reverseToWall();
-
-//            leftMotor.SetPercent(-50); Sleep(0.6);
-//            leftMotor.SetPercent(0);
-
-            //Line up to ramp step 44
-            driveForward(12);
-            pivotRightTurn();
-
-
-            reverseToWall();
-            reverseToWallBoth();
-
-            //goto menu;
-            //segment5:
-            Sleep(.5);
-            //Drive up ramp step 48
-            driveForward(8);
-            pivotRightTurn(); pivotRightTurn(); leftMotor.SetPercent(50); Sleep(.4); stop();
-
-            /**
-******************************
-*MIKE ADD CODE TO CHECK IF WE
-*ARE FACING SOUTH(0) TO GO
-*UP THE RAMP BACKWARDS*
-***********************************/
-
-            /**
-* MIKE
-* NOTE THAT SOMETIMES WE HIT THE WALL OF THE
-*CHILLER AND END UP TURNING AT THE TOP OF THE RAMP
-*/
-
-            reverseToWallHigh();
-            int count2=0;
-            if(backButtonRight.Value()==1&&backButtonLeft.Value()==0)
+            turned = true;
+            turnedTime = TimeNow();
+        }
+
+        // Right turns get a little extra time
+        if(direction != 0 || TimeNow() - turnedTime >= EXTRA_TURN_TIME) return true;
+
+        wheels.update(MIN_WHEEL_SPEED);
+        return false;
+    }
+
+    void finish()
+    {
+        // Stop turning
+        stop();
+    }
+
+    double expected() const
+    {
+        return profile.duration() + EXTRA_TURN_TIME;
+    }
+
+    void retry()
+    {
+        resuming = true;
+    }
+
+private:
+    int direction;
+    int correction;
+    int counts;
+    bool resuming;
+    float startHeading;
+    bool turned;
+    double turnedTime;
+    MotionProfile profile;
+    double startTime;
+};
+
+PivotTask pivotTask;
+
+// Pivot the robot in place
+void pivot(int direction, int correction = 0)
+{
+    pivotTask.set(direction, correction);
+    runPlanned(&pivotTask, movePlan);
+}
+
+// Readable function names for pivoting
+void pivotRightTurn() { pivot(0); }
+void pivotLeftTurn() { pivot(1); }
+
+// Swing on one wheel: the other one stays stopped while this one turns a set
+// number of counts, so the angle doesn't depend on the battery or the floor
+class SwingTask : public Task
+{
+public:
+    void set(RobotMotor &motor, EncoderSampler &wheel, float percent, float counts)
+    {
+        this->motor = &motor;
+        this->wheel = &wheel;
+        this->percent = percent;
+        this->counts = counts;
+    }
+
+    void start()
+    {
+        stop();
+        startCounts = wheel->counts();
+        motor->SetPercent(percent);
+    }
+
+    bool update()
+    {
+        // Cut the motor early enough that the wheel coasts onto the count
+        return wheel->predict(TimeNow(), tuning.stopLead) - startCounts >= counts;
+    }
+
+    void finish()
+    {
+        stop();
+    }
+
+    double expected() const
+    {
+        float speed = wheelSpeedAt(std::abs(percent));
+        return speed > 0 ? counts / speed : 0;
+    }
+
+private:
+    RobotMotor *motor;
+    EncoderSampler *wheel;
+    float percent;
+    float counts;
+    int startCounts;
+};
+
+SwingTask swingTask;
+
+void swing(RobotMotor &motor, EncoderSampler &wheel, float percent, float counts)
+{
+    swingTask.set(motor, wheel, percent, counts);
+    runPlanned(&swingTask, swingPlan);
+}
+
+// Swing on the left wheel, the robot turns about the right one
+void leftSwing(float percent, float counts) { swing(leftMotor, leftWheel, percent, counts); }
+
+// Swing on the right wheel
+void rightSwing(float percent, float counts) { swing(rightMotor, rightWheel, percent, counts); }
+
+// Drive a planned path in one go, turning by running the wheels at different
+// speeds instead of stopping to pivot
+class PathTask : public Task
+{
+public:
+    void set(const Path &path)
+    {
+        this->path = &path;
+        resuming = false;
+    }
+
+    void start()
+    {
+        // Reset the encoders
+        resetEncoders();
+
+        // Carry on from where we got to if we had to stop
+        done = resuming ? reached : 0;
+        resuming = false;
+        float curve;
+        startLead = leadAt(done, curve);
+
+        float countsPerInch = 1 / calibration.inchesPerCount;
+        totalCounts = path->length() * countsPerInch;
+        reached = done;
+
+        // One ramp up and down over the whole path, slowed on the arcs
+        cruise = wheelSpeedAt(tuning.speedHigh);
+        profile.plan(totalCounts - done, cruise, tuning.driveAccel, MIN_WHEEL_SPEED);
+        startTime = TimeNow();
+
+        wheels.start(1, 1);
+    }
+
+    bool update()
+    {
+        double now = TimeNow();
+        display.set(ROW_LEFT, "Left", leftWheel.counts());
+        display.set(ROW_RIGHT, "Right", rightWheel.counts());
+
+        // Done once the middle of the robot will have gone the length
+        float stopping = done + (leftWheel.predict(now, tuning.stopLead) + rightWheel.predict(now, tuning.stopLead)) / 2;
+        if(stopping >= totalCounts) return true;
+
+        float travelled = (leftWheel.position(now) + rightWheel.position(now)) / 2;
+        reached = done + travelled;
+
+        // Keep the outside wheel from being asked for more than cruise speed
+        float curve;
+        float lead = leadAt(reached, curve) - startLead;
+        float speed = profile.speed(now - startTime, travelled) / (1 + std::abs(curve));
+        wheels.update(speed, curve, lead);
+        return false;
+    }
+
+    void finish()
+    {
+        stop();
+    }
+
+    double expected() const
+    {
+        // The arcs are driven slower by the outside wheel's share
+        float countsPerInch = 1 / calibration.inchesPerCount;
+        double extra = 0;
+        for(int i = 0; i < path->count(); i++)
+        {
+            const PathSegment &piece = path->segment(i);
+            extra += piece.length * countsPerInch * std::abs(piece.curvature) * wheelBase() / 2 / cruise;
+        }
+        return profile.duration() + extra;
+    }
+
+    void retry()
+    {
+        resuming = true;
+    }
+
+private:
+    // How many counts the left wheel should be ahead of the right one after
+    // the middle of the robot has gone some counts along, and the curve of
+    // the piece we're on there
+    float leadAt(float counts, float &curve) const
+    {
+        float countsPerInch = 1 / calibration.inchesPerCount;
+        float along = 0, lead = 0;
+        curve = 0;
+        for(int i = 0; i < path->count(); i++)
+        {
+            const PathSegment &piece = path->segment(i);
+            float length = piece.length * countsPerInch;
+            curve = piece.curvature * wheelBase() / 2;
+            if(counts < along + length || i == path->count() - 1) return lead - 2 * curve * (counts - along);
+
+            lead -= 2 * curve * length;
+            along += length;
+        }
+        return lead;
+    }
+
+    const Path *path;
+    float totalCounts;
+    float done, reached;
+    float startLead;
+    float cruise;
+    bool resuming;
+    MotionProfile profile;
+    double startTime;
+};
+
+PathTask pathTask;
+
+// Drives a line of course points by pure pursuit on the pose, so RPS fixes
+// pull us back onto the line on the way instead of a square at the end
+class PursuitTask : public Task
+{
+public:
+    void set(const CoursePose *points, int numPoints)
+    {
+        pursuit.set(points, numPoints);
+    }
+
+    void start()
+    {
+        // Only what's left if we had to stop, the pursuit keeps its place
+        float countsPerInch = 1 / calibration.inchesPerCount;
+        startRemaining = pursuit.remaining() * countsPerInch;
+        cruise = wheelSpeedAt(tuning.speedHigh);
+        profile.plan(startRemaining, cruise, tuning.driveAccel, MIN_WHEEL_SPEED);
+        startTime = TimeNow();
+
+        wheels.start(1, 1);
+    }
+
+    bool update()
+    {
+        double now = TimeNow();
+        float curvature = pursuit.curvature(pose.x(), pose.y(), pose.heading(), PURSUIT_LOOKAHEAD);
+        float left = pursuit.remaining() / calibration.inchesPerCount;
+
+        // Done once what we coast after cutting the motors takes us to the end
+        float speed = (leftWheel.speed() + rightWheel.speed()) / 2;
+        if(left <= speed * tuning.stopLead) return true;
+
+        // Keep the outside wheel from being asked for more than cruise speed
+        float curve = curvature * wheelBase() / 2;
+        if(curve > PURSUIT_MAX_CURVE) curve = PURSUIT_MAX_CURVE;
+        if(curve < -PURSUIT_MAX_CURVE) curve = -PURSUIT_MAX_CURVE;
+        float target = profile.speed(now - startTime, startRemaining - left) / (1 + std::abs(curve));
+        wheels.steer(target, curve);
+
+        display.set(ROW_LEFT, "Off line", pursuit.offset());
+        display.set(ROW_RIGHT, "To go", pursuit.remaining());
+        return false;
+    }
+
+    void finish()
+    {
+        stop();
+    }
+
+    double expected() const
+    {
+        return profile.duration();
+    }
+
+private:
+    PurePursuit pursuit;
+    float startRemaining;
+    float cruise;
+    MotionProfile profile;
+    double startTime;
+};
+
+PursuitTask pursuitTask;
+
+//---------------------------------RPS Methods-------------------------------------------------------
+
+// Nearest of 0, 90, 180 and 270 degrees
+float closestQuarter(float heading)
+{
+    return wrapHeading(90 * std::floor(wrapHeading(heading) / 90 + .5));
+}
+
+// Turn in place onto a heading. Turns at a speed proportional to how far we
+// still have to go (plus a damping term), never so slow the wheels stall, and
+// finishes once the heading has stayed in tolerance for a moment.
+class TurnToHeadingTask : public Task
+{
+public:
+    TurnToHeadingTask() : controller(HEADING_KP, 0, HEADING_KD, -MAX_TURN_PERCENT, MAX_TURN_PERCENT) {}
+
+    void set(float target)
+    {
+        this->target = wrapHeading(target);
+    }
+
+    void start()
+    {
+        controller.reset();
+        lastTime = TimeNow();
+        settledTime = -1;
+    }
+
+    bool update()
+    {
+        double now = TimeNow();
+        float dt = now - lastTime;
+        lastTime = now;
+
+        // Positive error means we have to turn left (counterclockwise)
+        float error = angleDifference(target, pose.heading());
+
+        if(std::abs(error) < HEADING_TOLERANCE)
+        {
+            stop();
+            if(settledTime < 0) settledTime = now;
+            if(now - settledTime >= HEADING_SETTLE_TIME) return true;
+        }
+        else
+        {
+            settledTime = -1;
+
+            // Don't go below the effort that actually moves the robot
+            float effort = controller.update(error, dt);
+            if(effort > 0 && effort < MIN_TURN_PERCENT) effort = MIN_TURN_PERCENT;
+            if(effort < 0 && effort > -MIN_TURN_PERCENT) effort = -MIN_TURN_PERCENT;
+
+            leftMotor.SetPercent(-effort);
+            rightMotor.SetPercent(effort);
+        }
+
+        return false;
+    }
+
+    void finish()
+    {
+        stop();
+    }
+
+private:
+    PID controller;
+    float target;
+    double lastTime;
+    double settledTime;
+};
+
+TurnToHeadingTask turnTask;
+
+// Turn in place onto a heading
+void turnToHeading(float heading)
+{
+    turnTask.set(heading);
+    runPlanned(&turnTask, turnPlan);
+}
+
+// Pivot a quarter turn, squared up to the course if we know our heading
+void pivotRPS(int direction)
+{
+    float target = pose.heading() + (direction > 0 ? 90 : -90);
+
+    // Only snap to the course when RPS has told us where we are facing
+    if(pose.varianceHeading() < HEADING_KNOWN_VARIANCE) target = closestQuarter(target);
+
+    turnToHeading(target);
+}
+
+// Readable function names for pivoting
+void pivotRightTurnRPS() { pivotRPS(0); }
+void pivotLeftTurnRPS() { pivotRPS(1); }
+
+
+
+//-------------------------------End RPS ---------------------------------------------------------------------------
+
+
+// A path the robot drives in one go. Unless it's absolute the goals are
+// relative to where the robot is when it sets off: x ahead, y to the left and
+// the heading as a change from ours.
+struct Route
+{
+    const CoursePose *goals;
+    int numGoals;
+    bool absolute;
+};
+
+Path path;
+
+// Drive through a route's goals on arcs, or if there's no way to do that
+// (or an absolute one runs us into a wall) turn to each goal, drive to it and
+// turn to its heading the old way
+void followRoute(const Route &route)
+{
+    CoursePose from = { pose.x(), pose.y(), pose.heading() };
+
+    CoursePose goals[MAX_PATH_SEGMENTS];
+    int numGoals = route.numGoals < MAX_PATH_SEGMENTS ? route.numGoals : MAX_PATH_SEGMENTS;
+    for(int i = 0; i < numGoals; i++)
+    {
+        const CoursePose &goal = route.goals[i];
+        if(route.absolute)
+        {
+            goals[i] = goal;
+            continue;
+        }
+
+        float angle = from.heading * 3.14159 / 180;
+        goals[i].x = from.x + goal.x * std::cos(angle) - goal.y * std::sin(angle);
+        goals[i].y = from.y + goal.x * std::sin(angle) + goal.y * std::cos(angle);
+        goals[i].heading = wrapHeading(from.heading + goal.heading);
+    }
+
+    // Relative routes were laid out by hand where the robot is, the map only
+    // gets a say on absolute ones and only if we know where we are on it
+    bool known = pose.varianceX() < POSITION_KNOWN_VARIANCE && pose.varianceY() < POSITION_KNOWN_VARIANCE;
+    bool check = route.absolute && known;
+
+    // Steer absolute routes on the pose when we trust it, otherwise count wheel turns
+    bool steer = PATH_PURSUIT && route.absolute && known && pose.varianceHeading() < HEADING_KNOWN_VARIANCE;
+    CoursePose points[MAX_PURSUIT_POINTS];
+
+    if(path.plan(from, goals, numGoals, tuning.turnRadius, PATH_MIN_RADIUS) && (!check || path.clear(from, PATH_CLEARANCE)))
+    {
+        if(steer)
+        {
+            pursuitTask.set(points, path.sample(from, PURSUIT_SPACING, points, MAX_PURSUIT_POINTS));
+            runPlanned(&pursuitTask, movePlan);
+            return;
+        }
+
+        pathTask.set(path);
+        runPlanned(&pathTask, movePlan);
+        return;
+    }
+
+    display.set(ROW_STATUS, "No path");
+    if(steer)
+    {
+        // Straight through the goals in one go and only turn at the end
+        points[0] = from;
+        for(int i = 0; i < numGoals && i + 1 < MAX_PURSUIT_POINTS; i++) points[i + 1] = goals[i];
+        int numPoints = numGoals + 1 < MAX_PURSUIT_POINTS ? numGoals + 1 : MAX_PURSUIT_POINTS;
+        turnToHeading(std::atan2(points[1].y - from.y, points[1].x - from.x) * 180 / 3.14159);
+        pursuitTask.set(points, numPoints);
+        runPlanned(&pursuitTask, movePlan);
+        turnToHeading(points[numPoints - 1].heading);
+        return;
+    }
+
+    for(int i = 0; i < numGoals; i++)
+    {
+        float dx = goals[i].x - pose.x(), dy = goals[i].y - pose.y();
+        turnToHeading(std::atan2(dy, dx) * 180 / 3.14159);
+        drive(std::sqrt(dx * dx + dy * dy), 1);
+        turnToHeading(goals[i].heading);
+    }
+}
+
+
+// Knows where the lift is and drives it to a target height in the background.
+// It homes against the bottom switch once, after that the encoder counts
+// (signed by the way the motor was last driven) keep an absolute position.
+// Touching the bottom switch again zeroes it for free.
+class LiftServo : public Task
+{
+public:
+    LiftServo()
+    {
+        homed = false;
+        mode = LIFT_IDLE;
+        position = 0;
+        target = 0;
+        lastCounts = 0;
+        pullCounts = 0;
+        pullStart = 0;
+    }
+
+    // Go to a height in counts above the bottom switch, homing first if we
+    // never have. Zero or less goes all the way down onto the switch.
+    void moveTo(int counts)
+    {
+        target = counts;
+        if(homed) startMove();
+        else
+        {
+            mode = LIFT_HOMING;
+            moveStart = TimeNow();
+            liftMotor.SetPercent(LIFT_SPEED_DOWN);
+        }
+    }
+
+    // Run the motor until the shaft has turned some counts, for pulls that
+    // don't end at a height (the pin, lifting the skid off the floor,
+    // pushing past the top to dump). Stops early on a jam or the left button.
+    void pull(float percent, int counts)
+    {
+        mode = LIFT_PULLING;
+        pullCounts = counts;
+        pullStart = liftShaft.counts();
+        moveStart = TimeNow();
+        moveDeadline = moveStart + remaining() + LIFT_MOVE_SLACK;
+        liftMotor.SetPercent(percent);
+    }
+
+    // Drive the motor by hand, the position is still kept track of
+    void manual(float percent)
+    {
+        mode = LIFT_IDLE;
+        liftMotor.SetPercent(percent);
+    }
+
+    // Nothing left to do, the last move got there or gave up
+    bool settled() const
+    {
+        return mode == LIFT_IDLE;
+    }
+
+    // Seconds the rest of the move should take
+    double remaining() const
+    {
+        if(settled()) return 0;
+        if(mode == LIFT_PULLING) return (pullCounts - (liftShaft.counts() - pullStart) + 1) * LIFT_SECONDS_PER_COUNT;
+
+        int from = homed ? position : LIFT_COUNTS_TO_TOP;
+        return (std::abs(target - from) + 1) * LIFT_SECONDS_PER_COUNT;
+    }
+
+    // Counts above the bottom switch
+    int height() const
+    {
+        return position;
+    }
+
+    bool update()
+    {
+        // The encoder only counts up, the motor direction says which way
+        // (negative percent raises the lift)
+        int counts = liftShaft.counts();
+        position -= (counts - lastCounts) * liftMotor.Direction();
+        lastCounts = counts;
+
+        bool bottom = inputs.liftBottom.pressed();
+        if(bottom) position = 0;
+
+        if(mode == LIFT_HOMING)
+        {
+            // Stalled on the bottom without the switch closing counts as home too
+            if(bottom || liftStall.stalled() || TimeNow() - moveStart >= LIFT_HOME_TIMEOUT)
+            {
+                liftMotor.SetPercent(0);
+                position = 0;
+                homed = true;
+                startMove();
+            }
+        }
+        else if(mode == LIFT_PULLING)
+        {
+            // Cut the motor early enough that it coasts onto the count
+            float pulled = liftShaft.predict(TimeNow(), LIFT_STOP_LEAD) - pullStart;
+            if(pulled >= pullCounts || inputs.stopButton.pressed() || liftStall.stalled() || TimeNow() >= moveDeadline)
+            {
+                manual(0);
+            }
+        }
+        else if(mode == LIFT_MOVING)
+        {
+            // Left button stops the lift by hand
+            if(inputs.stopButton.pressed() || TimeNow() >= moveDeadline)
+            {
+                manual(0);
+            }
+            else if(liftStall.stalled())
+            {
+                // On the way down that's the bottom without the switch, on
+                // the way up something is in the way. Don't grind on it.
+                if(target <= 0) position = 0;
+                else display.set(ROW_STATUS, "Lift jammed");
+                manual(0);
+            }
+            else if(target <= 0)
+            {
+                if(bottom) manual(0);
+            }
+            else
             {
-                rightMotor.SetPercent(50); Sleep(.7); rightMotor.SetPercent(0);
-                driveForward(4);
-                rightMotor.SetPercent(-50); Sleep(.7); rightMotor.SetPercent(0);
-                reverseToWall();
+                // Cut the motor early enough that it coasts onto the target
+                int ahead = liftShaft.predict(TimeNow(), LIFT_STOP_LEAD) - counts;
+                if(liftMotor.Direction() < 0 ? position + ahead >= target : position - ahead <= target)
+                {
+                    manual(0);
+                }
             }
+        }
+        return false;
+    }
+
+private:
+    void startMove()
+    {
+        if(target <= 0 ? position <= 0 && inputs.liftBottom.pressed() : target == position)
+        {
+            mode = LIFT_IDLE;
+            return;
+        }
 
-            //Position ourselves in front of switch
+        mode = LIFT_MOVING;
+        moveStart = TimeNow();
+        moveDeadline = moveStart + remaining() + LIFT_MOVE_SLACK;
+        liftMotor.SetPercent(target > position ? -LIFT_SPEED_UP : LIFT_SPEED_DOWN);
+    }
 
-            else if((backButtonLeft.Value() == 1 || backButtonRight.Value() == 1) && count2 < 1)
-            {
+    enum Mode { LIFT_IDLE, LIFT_HOMING, LIFT_MOVING, LIFT_PULLING };
 
-                leftMotor.SetPercent(50);
-                Sleep(.7);
-                driveForward(5);
-                leftMotor.SetPercent(-50);
-                Sleep(.7);
-                reverseToWall();
-                Sleep(.7);
-                count2++;
-            }
+    bool homed;
+    Mode mode;
+    int position;
+    int target;
+    int lastCounts;
+    int pullCounts;
+    int pullStart;
+    double moveStart;
+    double moveDeadline;
+};
+
+LiftServo lift;
+
+// Waits for the lift to finish its move
+class LiftWaitTask : public Task
+{
+public:
+    double expected() const
+    {
+        return lift.remaining();
+    }
+
+    bool update()
+    {
+        return lift.settled();
+    }
+};
+
+LiftWaitTask liftWaitTask;
+
+// Don't wait on a lift that won't get there, the mission goes on without it
+WaitPlan liftPlan = { LIFT_DEADLINE, { 0 } };
+
+// Wait for the lift, stopping it if it doesn't make it
+void liftWait()
+{
+    runPlanned(&liftWaitTask, liftPlan);
+    if(!lift.settled()) lift.manual(0);
+}
+
+// Set the lift height in the background, the robot is free to drive
+void liftHeightAsync(int clicks)
+{
+    lift.moveTo(clicks);
+}
+
+// Set the lift height
+void liftHeight(int clicks)
+{
+    lift.moveTo(clicks);
+    liftWait();
+}
+
+// Back square onto a wall. Each wheel reverses until the bump switch on its
+// side closes, then only leans on the wall while the other side catches up.
+// Done the moment both switches are closed, or once the other side has had
+// long enough to swing in (something is in its way, this is as square as
+// we'll get).
+class SquareTask : public Task
+{
+public:
+    void set(float percent)
+    {
+        this->percent = percent;
+    }
+
+    // Whether the last square ended with both switches on the wall
+    bool squared() const
+    {
+        return bothClosed;
+    }
+
+    // The side that didn't make it, 1 for the left switch, -1 for the right
+    int openSide() const
+    {
+        return inputs.backLeft.pressed() ? -1 : 1;
+    }
+
+    void start()
+    {
+        touched = false;
+        bothClosed = false;
+        startTime = TimeNow();
+        leftMotor.SetPercent(-percent);
+        rightMotor.SetPercent(-percent);
+    }
+
+    bool update()
+    {
+        bool left = inputs.backLeft.pressed();
+        bool right = inputs.backRight.pressed();
+        bool bumped = inputs.backLeft.rose() || inputs.backRight.rose();
+        if(left && right)
+        {
+            bothClosed = true;
+            stop();
+            if(bumped) timeBump();
+            return true;
+        }
+
+        if((left || right) && !touched)
+        {
+            touched = true;
+            // A switch already closed when we started counts from the start
+            touchTime = left ? inputs.backLeft.changedAt() : inputs.backRight.changedAt();
+            if(touchTime < startTime) touchTime = startTime;
+        }
+        if(touched && TimeNow() - touchTime >= tuning.squareSwing) return true;
+
+        leftMotor.SetPercent(left ? -tuning.squareHold : -percent);
+        rightMotor.SetPercent(right ? -tuning.squareHold : -percent);
+        if(bumped) timeBump();
+        return false;
+    }
+
+    void finish()
+    {
+        stop();
+    }
+
+private:
+    // From the switch that just closed first reading closed to the wheels
+    // being told, so the debounce hold counts too
+    void timeBump()
+    {
+        const DebouncedInput &bump = inputs.backLeft.rose() ? inputs.backLeft : inputs.backRight;
+        bumpReaction.add(TimeNow() - bump.seenAt());
+    }
+
+    float percent;
+    bool touched;
+    bool bothClosed;
+    double startTime;
+    double touchTime;
+};
+
+SquareTask squareTask;
+
+// Back up until both switches are on the wall
+void squareToWall(float percent = tuning.speedLow)
+{
+    squareTask.set(percent);
+    runPlanned(&squareTask, wallPlan);
+}
+
+// If the last square only got one switch on the wall, something is in the way
+// of the other side (the chiller door, the chiller wall at the top of the
+// ramp). Swing that side out, come off the wall and square up again.
+void resquare(float distance, float counts)
+{
+    if(squareTask.squared()) return;
+
+    bool left = squareTask.openSide() > 0;
+    RobotMotor &open = left ? leftMotor : rightMotor;
+    EncoderSampler &wheel = left ? leftWheel : rightWheel;
+    swing(open, wheel, RESQUARE_PERCENT, counts);
+    driveForward(distance);
+    swing(open, wheel, -RESQUARE_PERCENT, counts);
+    squareToWall();
+}
+
+// Wait for the CdS cell to see the start light (or give up). Goes as soon as
+// the readings are surely lower than with no light, whenever the test says
+// there's surely no light yet it starts over.
+class LightWaitTask : public Task
+{
+public:
+    LightWaitTask() : test(0, CDS_START_DROP, CDS_NOISE, CDS_CONFIDENCE, CDS_CONFIDENCE, CDS_MAX_EVIDENCE) {}
+
+    void start()
+    {
+        light.setBaseline();
+        test.reset();
+        startTime = TimeNow();
+    }
+
+    bool update()
+    {
+        display.set(ROW_CDS, "CdS", light.latest());
+
+        int result = test.add(light.drop());
+        if(result < 0) test.reset();
+        return result > 0 || TimeNow() - startTime >= CDS_START_TIMEOUT;
+    }
+
+private:
+    SequentialTest test;
+    double startTime;
+};
+
+LightWaitTask lightWaitTask;
+
+void takeBreak()
+{
+    delay(tuning.breakTime);
+}
+
+// ***********************CALIBRATION***********************************
+// Picked from the segment menu. Start with the robot's back near a wall and a
+// couple of feet clear in front of it.
+
+// Inches per count from how far RPS says a straight run out from the wall went
+bool calibrateDistance()
+{
+    squareToWall();
+    delay(CAL_RPS_WAIT);
+    float startX = RPS.X(), startY = RPS.Y();
+    if(!rpsFix(startX, startY)) return false;
+
+    resetEncoders();
+    leftMotor.SetPercent(CAL_DRIVE_PERCENT);
+    rightMotor.SetPercent(CAL_DRIVE_PERCENT);
+    double startTime = TimeNow();
+    while(leftWheel.counts() + rightWheel.counts() < 2 * CAL_DRIVE_COUNTS && TimeNow() - startTime < CAL_TIMEOUT)
+    {
+        scheduler.tick();
+    }
+    stop();
+
+    // Let it coast to a stop, those counts count too
+    delay(CAL_RPS_WAIT);
+    float counts = (leftWheel.counts() + rightWheel.counts()) / 2.0;
+    float endX = RPS.X(), endY = RPS.Y();
+    if(!rpsFix(endX, endY) || counts < CAL_DRIVE_COUNTS / 2) return false;
+
+    float dx = endX - startX, dy = endY - startY;
+
+    calibration.inchesPerCount = std::sqrt(dx * dx + dy * dy) / counts;
+    return true;
+}
+
+// Counts for a full pivot from the heading RPS sees us turn through
+bool calibratePivot()
+{
+    float x = RPS.X(), y = RPS.Y();
+    float last = RPS.Heading();
+    if(!rpsFix(x, y)) return false;
+
+    resetEncoders();
+    leftMotor.SetPercent(-CAL_PIVOT_PERCENT);
+    rightMotor.SetPercent(CAL_PIVOT_PERCENT);
+
+    // Add up every change in heading, taking the counts when each one comes in
+    float turned = 0, counts = 0;
+    double startTime = TimeNow();
+    while(turned < 360 * CAL_PIVOT_TURNS && TimeNow() - startTime < CAL_TIMEOUT)
+    {
+        scheduler.tick();
+        x = RPS.X();
+        y = RPS.Y();
+        float heading = RPS.Heading();
+        if(!rpsFix(x, y) || heading == last) continue;
+
+        turned += angleDifference(heading, last);
+        last = heading;
+        counts = (leftWheel.counts() + rightWheel.counts()) / 2.0;
+    }
+    stop();
+
+    if(turned < 360 * CAL_PIVOT_TURNS) return false;
+
+    calibration.countsPerTurn = counts * 360 / turned;
+    return true;
+}
 
-            reverseToWall();
+// Fit a straight line of wheel speed against motor percent for each wheel.
+// Pivoting keeps the robot on the spot while we try every percent. Returns
+// false and leaves the calibration alone if the fit makes no sense, say a
+// wheel that never turned.
+bool calibrateMotors()
+{
+    static const float percents[] = { 30, 45, 60, 75, 90 };
+    const int n = sizeof(percents) / sizeof(float);
 
+    // Sums for the least squares fits
+    float sumP = 0, sumPP = 0, sumL = 0, sumPL = 0, sumR = 0, sumPR = 0;
 
-            //goto menu;
-            //segment6:
-            Sleep(.5);
+    for(int i = 0; i < n; i++)
+    {
+        float percent = percents[i];
+        leftMotor.SetPercent(-percent);
+        rightMotor.SetPercent(percent);
+        delay(CAL_SETTLE_TIME);
+
+        int left = leftWheel.counts(), right = rightWheel.counts();
+        double startTime = TimeNow();
+        delay(CAL_MEASURE_TIME);
+        double elapsed = TimeNow() - startTime;
+
+        float leftSpeed = (leftWheel.counts() - left) / elapsed;
+        float rightSpeed = (rightWheel.counts() - right) / elapsed;
+        display.set(ROW_LEFT, "Left", leftSpeed);
+        display.set(ROW_RIGHT, "Right", rightSpeed);
+
+        sumP += percent;
+        sumPP += percent * percent;
+        sumL += leftSpeed;
+        sumPL += percent * leftSpeed;
+        sumR += rightSpeed;
+        sumPR += percent * rightSpeed;
+    }
+    stop();
 
-            //Turn to face the switch
-            driveForward(4);
-            pivotLeftTurn(); pivotLeftTurn(); stop();
+    // speed = gain * (percent - deadband)
+    float spread = n * sumPP - sumP * sumP;
+    if(spread <= 0) return false;
+    float leftGain = (n * sumPL - sumP * sumL) / spread;
+    float rightGain = (n * sumPR - sumP * sumR) / spread;
+    float leftDeadband = sumP / n - sumL / n / leftGain;
+    float rightDeadband = sumP / n - sumR / n / rightGain;
+
+    // Every percent we tried should have turned the wheels, so the gains are
+    // positive and the deadbands below all of them
+    bool good = std::isfinite(leftGain) && std::isfinite(rightGain) && leftGain > 0 && rightGain > 0 &&
+                leftDeadband < percents[0] && rightDeadband < percents[0];
+    if(!good) return false;
+
+    calibration.leftGain = leftGain;
+    calibration.rightGain = rightGain;
+    calibration.leftDeadband = leftDeadband;
+    calibration.rightDeadband = rightDeadband;
+    return true;
+}
 
-            //Drive to switch then turn it
-            driveForward(9);
-            pivotLeftTurn();
+// Measure everything we can, show it and save it to the profile
+void calibrate()
+{
+    display.clear();
+    display.set(ROW_STATUS, "Calibrating");
 
-            //Need to test this area more
+    bool distance = calibrateDistance();
+    bool pivot = calibratePivot();
+    bool motors = calibrateMotors();
 
-            driveBackward(7);
-            rightMotor.SetPercent(-60);
-            Sleep(0.8);
-            rightMotor.SetPercent(0);
+    // The results go straight on the LCD, keep the status rows off them
+    display.hold(true);
+    LCD.Clear(FEHLCD::Black);
+    if(!distance) LCD.WriteLine("Distance: no RPS");
+    if(!pivot) LCD.WriteLine("Pivot: no RPS");
+    if(!motors) LCD.WriteLine("Motors: bad fit");
+    LCD.Write("Counts/turn ");
+    LCD.WriteLine(calibration.countsPerTurn);
+    LCD.Write("In/count ");
+    LCD.WriteLine(calibration.inchesPerCount);
+    LCD.Write("Left ");
+    LCD.Write(calibration.leftGain);
+    LCD.Write(" ");
+    LCD.WriteLine(calibration.leftDeadband);
+    LCD.Write("Right ");
+    LCD.Write(calibration.rightGain);
+    LCD.Write(" ");
+    LCD.WriteLine(calibration.rightDeadband);
+
+    // A bad fit would only make the next run worse
+    if(!motors) LCD.WriteLine("Profile not saved");
+    else if(!saveCalibration(CALIBRATION_FILE, calibration)) LCD.WriteLine("Profile not saved");
+
+    // Leave the numbers up until the operator is done reading them, with the
+    // services still running
+    LCD.WriteLine("M to go on");
+    while(!buttons.MiddlePressed()) scheduler.tick();
+    while(buttons.MiddlePressed()) scheduler.tick();
+    display.hold(false);
+}
+//End functions
 
-/******************************
-0*MIKE ADD CODE TO CHECK IF WE
-                    /**
-*ARE FACING NORTH(0) TO GO
-*BACKWARDS INTO THE WALL OPPOSITE OF THE SKID
-***********************************/
+//---------------------------------------------------------------------------------------------------------
 
-          //  reverseToWall();
+// ***********************MISSION STEPS*********************************
+// Every primitive gets a three number version so it can go in the mission
+// table. Numbers a step doesn't need are ignored.
+
+// Light color read in segment 2, used when dropping the scoop
+int blue = 0;
+
+void stepForward(float distance, float, float) { driveForward(distance); }
+void stepBackward(float distance, float, float) { driveBackward(distance); }
+void stepPivot(float direction, float correction, float) { pivot(direction, correction); }
+void stepPivotLeft(float, float, float) { pivotLeftTurn(); }
+void stepPivotRight(float, float, float) { pivotRightTurn(); }
+void stepSquare(float percent, float, float) { squareToWall(percent > 0 ? percent : tuning.speedLow); }
+void stepResquare(float distance, float counts, float) { resquare(distance, counts); }
+void stepLeftSwing(float percent, float counts, float) { leftSwing(percent, counts); }
+void stepRightSwing(float percent, float counts, float) { rightSwing(percent, counts); }
+void stepStop(float, float, float) { stop(); }
+void stepDelay(float seconds, float, float) { delay(seconds); }
+void stepBreak(float, float, float) { takeBreak(); }
+void stepLeftMotor(float percent, float, float) { leftMotor.SetPercent(percent); }
+void stepRightMotor(float percent, float, float) { rightMotor.SetPercent(percent); }
+void stepLift(float clicks, float, float) { liftHeight(clicks); }
+void stepLiftAsync(float clicks, float, float) { liftHeightAsync(clicks); }
+void stepLiftMotor(float percent, float, float) { lift.manual(percent); }
+void stepLiftPull(float percent, float counts, float) { lift.pull(percent, counts); }
+void stepLiftWait(float, float, float) { liftWait(); }
+
+// Wait for the start light, the course clock starts when it comes on
+void stepStartLight(float, float, float)
+{
+    scheduler.run(&lightWaitTask);
+    course.startClock();
+}
 
+// Work backward along a wall until only the right switch is pressed
+void stepLineUp(float timeout, float distance, float percent)
+{
+    double startTime = TimeNow();
+    while(TimeNow()-startTime<timeout) {
+        bool left = inputs.backLeft.pressed(), right = inputs.backRight.pressed();
+        if(!left && right) { delay(.8); stop(); break; }
+        else if(!left && !right) { driveBackward(0); display.set(ROW_STATUS, "WHY!"); }
+        else if(left && right) {
+            display.set(ROW_STATUS, "DrivingLoop");
+            driveForward(distance);
+            leftSwing(percent, LINE_UP_SWING_COUNTS);
+            driveBackward(0);
+            delay(.4);
+        }
+        scheduler.tick();
+    }
+}
 
+// Reverse to wall and if stuck (or still not there after a second) move the
+// right motor back
+void stepReverseOntoRamp(float, float, float)
+{
+    driveBackward(-1);
+    double startTime = TimeNow();
+    while(!inputs.backRight.pressed() && !inputs.backLeft.pressed())
+    {
+        if(wheelsStalled() || TimeNow()-startTime>1) {rightSwing(-40, RAMP_SWING_COUNTS); break;}
+        scheduler.tick();
+    }
+}
 
-            //driveBackward(14);
-            pivotRightTurn();
+// Shuffle back and forth until the cds cell is over the light
+void stepFindLight(float, float, float)
+{
+    int parity = 1; //Find the light
+    light.setBaseline(); // what the cell reads before it's over the light
+    double startTime = TimeNow();
+    while(light.base() - light.median() < CDS_FIND_DROP && (TimeNow()-startTime)<3.0) {
+        if(parity) {
+            driveForward(2);
+            parity = 0;
+        } else {
+            driveBackward(1);
+            parity = 1;
+        }
+    }
+}
 
-            rightMotor.SetPercent(-40);
-            Sleep(1.0);
-            rightMotor.SetPercent(0);
+// Tells red from blue by how far the light brings the reading down
+SequentialTest colorTest(CDS_BLUE_DROP, CDS_RED_DROP, CDS_NOISE, CDS_CONFIDENCE, CDS_CONFIDENCE, CDS_MAX_EVIDENCE);
 
-            Sleep(0.8);
+// Determining the light color, as soon as the readings make it clear
+void stepReadColor(float, float, float)
+{
+    colorTest.reset();
+    int result = 0;
+    double startTime = TimeNow();
+    while(result == 0 && TimeNow() - startTime < CDS_COLOR_TIMEOUT) {
+        scheduler.tick();
+        result = colorTest.add(light.drop());
+    }
 
-            //rightMotor.SetPercent(-40);
+    // Never sure, go with whichever the median is closer to
+    if(result == 0) result = light.base() - light.median() > (CDS_RED_DROP + CDS_BLUE_DROP) / 2 ? 1 : -1;
+    blue = result < 0;
 
-            reverseToWallHigh();
+    if(blue) display.set(ROW_STATUS, "I'm blue :(");
+    else display.set(ROW_STATUS, "Red, blood of angry men");
+}
+
+// Drive to the scoop drop for the light color
+void stepToScoopDrop(float blueDistance, float redDistance, float)
+{
+    if(blue)
+    driveForward(blueDistance);
+    else driveForward(redDistance);
+}
+
+// ***********************ROUTES****************************************
+// Corners we used to take as drive, stop, pivot, stop. Goals are relative to
+// where the robot sets off (inches ahead, inches left, heading change),
+// except for the ones in course coordinates.
+
+enum RouteName
+{
+    ROUTE_TO_SKID,
+    ROUTE_LEFT_CORNER,
+    ROUTE_RIGHT_CORNER,
+    ROUTE_JOG_LEFT,
+    ROUTE_JOG_RIGHT,
+    ROUTE_TO_RAMP,
+    ROUTE_TO_SWITCH,
+    ROUTE_TO_LIGHT,
+    ROUTE_TO_CHARGER,
+};
+
+// Was forward 35 and a left pivot
+const CoursePose toSkid[] = { { 35, 8, 90 } };
+
+// Were forward 5 and a pivot
+const CoursePose leftCorner[] = { { 5, 5, 90 } };
+const CoursePose rightCorner[] = { { 5, -5, -90 } };
+
+// Were a swing, a short drive and a swing back, to slide over along a wall
+const CoursePose jogLeft[] = { { 5.5, 3.8, 45 }, { 11, 7.6, 0 } };
+const CoursePose jogRight[] = { { 5, -3, -45 }, { 10, -6.1, 0 } };
+
+// Was forward 12 and a right pivot, now on the map below the ramp
+const CoursePose toRamp[] = { courseRamp };
+
+// Was forward 9 and a left pivot, the backup after it goes 8 more. Still
+// relative, it runs into the right hand wall of the stand-in course so there
+// is no pose on the map to give it.
+const CoursePose toSwitch[] = { { 9, 8, 90 } };
+
+// From the skid, on the map to in front of the counter light
+const CoursePose toLight[] = { courseLight };
+
+// Wherever the switch or the oven left us, on the map to the front of the charger
+const CoursePose toCharger[] = { courseCharger };
+
+Route routes[] = {
+    { toSkid, sizeof(toSkid) / sizeof(CoursePose), false },
+    { leftCorner, sizeof(leftCorner) / sizeof(CoursePose), false },
+    { rightCorner, sizeof(rightCorner) / sizeof(CoursePose), false },
+    { jogLeft, sizeof(jogLeft) / sizeof(CoursePose), false },
+    { jogRight, sizeof(jogRight) / sizeof(CoursePose), false },
+    { toRamp, sizeof(toRamp) / sizeof(CoursePose), true },
+    { toSwitch, sizeof(toSwitch) / sizeof(CoursePose), false },
+    { toLight, sizeof(toLight) / sizeof(CoursePose), true },
+    { toCharger, sizeof(toCharger) / sizeof(CoursePose), true },
+};
+
+void stepRoute(float route, float, float) { followRoute(routes[(int)route]); }
+
+// ***********************MISSION***************************************
+//The program goes for the objectives in this order: pin, skid, read light, drop skid, drop scoop, flip switch, then the oven button and the charger if there is time
+
+//SEgment one will pick up the skid
+Step pinAndSkid[] = {
+    { "Home lift", stepLift, 0 },
+    { "Lift off floor", stepLiftAsync, LIFT_COUNTS_OFF_FLOOR },
+    { "Start light", stepStartLight },
+
+    // Drive to in front of the skid Step 1
+    // RPS CHECK X
+
+    //Turn and use the opposite skid wall as a lining up tool
+    { "To skid", stepRoute, ROUTE_TO_SKID },
+    { "Square", stepSquare },
+    { "Line up pin", stepLineUp, 1.0, 3, 50 },
+
+    { "Forward", stepForward, 1.5 },
+    // CHECK RPS Y
+    { "Turn to pin", stepPivotRight },
+
+    { "Catch pipe", stepForward, 5.0 },
+    { "Nudge left", stepLeftSwing, 40, 4 },
+
+    //Make sure we don't hit the tube the whole time
+    { "Wait", stepDelay, .2 },
+    { "Back off", stepBackward, 0 },
+    { "Back off", stepDelay, .1 },
+    { "Stop", stepStop },
+
+    //Pull the pin
+    { "Pull pin", stepLiftPull, -44, 8 }, //from -50
+    { "Pull pin", stepLiftWait },
+    { "Back away", stepBackward, 2 },
+    { "Break", stepBreak },
+
+    //Lower lift to help pick up skid while we turn and back up
+    { "Lower lift", stepLiftAsync, 0 },
+    { "Turn", stepPivotLeft },
+    { "Stop", stepStop },
+
+    //Back up to opposite skid wall to line up with skid
+    { "Back up", stepBackward, 0 },
+    { "Line up skid", stepLineUp, 4.0, 2, 60 },
+    { "Nudge right", stepRightSwing, 40, 1 },
+
+    //Lift has to be all the way down before we scoop the skid
+    { "Wait for lift", stepLiftWait },
+
+    //Pick up skid step 6
+    { "Pick up skid", stepForward, 17 },
+    { "Lift skid", stepLiftPull, -46, 8 },
+    { "Break", stepBreak },
+
+    //Navigate to ramp and yada yada step 9
+    { "Back out", stepBackward, 12 },
+    { "Turn", stepPivotLeft },
+    { "Stop", stepStop },
+    { "To center", stepForward, 9 },
+    { "Break", stepBreak },
+
+    //Turn so as to go down ramp
+    { "Turn", stepPivot, 1 },
+    { "Onto ramp wall", stepReverseOntoRamp },
+
+    { "Forward", stepForward, 4 },
+    { "Turn", stepPivotRight },
+    { "Turn", stepPivotRight },
+    { "Swing left", stepLeftSwing, 50, 18 },
+};
+
+//Segment 2 will Read the light
+Step readLight[] = {
+    { "Wait", stepDelay, .2 },
+    { "To light", stepRoute, ROUTE_TO_LIGHT },
+    { "To counter", stepSquare }, //Drive back until the counter is hit
+    { "Find light", stepFindLight },
+    { "Read color", stepReadColor },
+
+    //Deposit skid step 19
+    { "To counter", stepSquare }, //Back to the counter
+};
+
+//Deposit the skid in segment 3
+Step dropSkid[] = {
+    { "Wait", stepDelay, .5 },
+    { "Forward", stepForward, 2 },
+    { "Turn", stepPivotRight },
+    { "Square", stepSquare },
+    { "Chiller door", stepResquare, 2, 3 },
+
+    { "Forward", stepForward, .5 },
+    { "Face chiller", stepPivotLeft }, //Now I'm facing the chiller
+    { "Square", stepSquare },
+
+    //Deposit skid in chiller step 28
+    { "Into chiller", stepForward, 12 },
+    { "Drop skid", stepLift, 0 },
+    { "Back off", stepBackward, 4 },
+
+    //Raise the lift on the way back to the wall
+    { "Raise lift", stepLiftAsync, LIFT_COUNTS_TO_MIDDLE },
+    { "Forward", stepForward, 12 },
+
+    //move to corner to begin scoop dropping step 33
+    { "Square", stepSquare }, //Skid is all good and we are on the opposite wall
+};
+
+//segment4 drops the scoop
+Step dropScoop[] = {
+    { "Wait", stepDelay, .3 },
+
+    //Get to the front corner of the shop
+    { "Corner", stepRoute, ROUTE_LEFT_CORNER },
+    { "Square", stepSquare },
+    //Now corner check
+    { "Corner", stepRoute, ROUTE_RIGHT_CORNER },
+    { "Square", stepSquare },
+    //Get back to the correct wall
+    { "Forward", stepForward, 3 },
+    { "Turn", stepPivotLeft },
+    { "Square", stepSquare },
+
+    { "Slide left", stepRoute, ROUTE_JOG_LEFT },
+    { "Square", stepSquare },
+
+    //deposit scoop step 37 CORNER
+    { "To drop", stepToScoopDrop, 5, 20 },
+    { "Raise lift", stepLift, LIFT_COUNTS_TO_DUMP },
+    { "Dump scoop", stepLiftPull, -80, 6 },
+    { "Dump scoop", stepLiftWait },
+    { "Square", stepSquare },
+
+    //Lift comes down while we get away from the corner
+    { "Lower lift", stepLiftAsync, 0 },
+
+    //Get away from corner step 40 CAN USE RPS TO FIND 90 DEGREES HERE
+    { "Slide right", stepRoute, ROUTE_JOG_RIGHT },
+    { "Square", stepSquare },
+
+    //Line up to ramp step 44
+    { "To ramp", stepRoute, ROUTE_TO_RAMP },
+    { "Square", stepSquare },
+};
+
+//segment5 goes up the ramp
+Step upRamp[] = {
+    { "Wait", stepDelay, .5 },
+    //Drive up ramp step 48
+    { "Forward", stepForward, 8 },
+    { "Turn", stepPivotRight },
+    { "Turn", stepPivotRight },
+    { "Swing left", stepLeftSwing, 50, 10 },
+
+    { "Up ramp", stepSquare, SQUARE_RAMP_PERCENT, 0, 0, &rampPlan }, // backing off would roll us down
+    { "Top of ramp", stepResquare, 4, 18 },
+    { "Square", stepSquare },
+};
+
+// Pushes the oven button once more
+void stepPressAgain(float back, float forward, float)
+{
+    driveBackward(back);
+    driveForward(forward);
+}
 
-            /**
-WE SHOULD BE HITTING THE OVEN AT THIS POINT BUT
-THE ROBOT HEADS TO THE CHARGER INSTEAD AND WE
-ARE LEAVING IT AS SO FOR NOW BECAUSE
-IT STILL GETS US 8 POINTS*/
-/*
-driveForward(1);
-pivotLeftTurnRPS();
-reverseToWall();
-driveForward(4);
-pivotLeftTurnRPS();
-//Pushing the oven button
-int oven = RPS.Oven();
-driveForward(6);
-int count=1;
-while(count<oven&&count<3)
+// From where the switch leaves us, push the oven button as many times as it
+// asks and line up to back into the charger
+Step ovenSteps[] = {
+    { "Forward", stepForward, 1 },
+    { "Turn", stepPivotLeft },
+    { "Square", stepSquare },
+    { "Forward", stepForward, 4 },
+    { "Turn", stepPivotLeft },
+    { "Oven", stepForward, 6 },
+    { "Oven again", stepPressAgain, 2, 3 },
+    { "Back out", stepBackward, 4 },
+    { "Turn", stepPivotRight },
+    { "Square", stepSquare },
+    { "Forward", stepForward, 2 },
+    { "Turn", stepPivotRight },
+};
+
+// Back up into the charger, from the switch or the oven
+Step chargerSteps[] = {
+    { "To charger", stepRoute, ROUTE_TO_CHARGER },
+    { "Into charger", stepSquare, SQUARE_RAMP_PERCENT, 0, 0, &rampPlan },
+};
+
+enum ObjectiveName
 {
-driveBackward(2);
-driveForward(3);
-count++;
+    OBJECTIVE_OVEN,
+    OBJECTIVE_CHARGER,
+};
+
+Objective objectives[] = {
+    { "Oven", ovenSteps, sizeof(ovenSteps) / sizeof(Step), 6, OVEN_POINTS, OVEN_GUESS },
+    { "Charger", chargerSteps, sizeof(chargerSteps) / sizeof(Step), -1, CHARGER_POINTS, CHARGER_GUESS },
+};
+
+Planner planner(objectives, sizeof(objectives) / sizeof(Objective));
+
+// Do whichever optional objectives fit in what's left of the course time
+void stepObjectives(float, float, float)
+{
+    // The oven shows how many presses it wants, no RPS means none
+    int presses = RPS.Oven();
+    planner.setGoes(OBJECTIVE_OVEN, presses < OVEN_MAX_PRESSES ? presses : OVEN_MAX_PRESSES);
+    planner.run(course, COURSE_TIME_LIMIT - PLAN_MARGIN);
 }
-//Reverse in front of charger
-driveBackward(4);
-pivotRightTurnRPS();
-reverseToWall();
-//Turn away from charger and then reverse into it
-driveForward(2);
-pivotRightTurnRPS();
-reverseToWall();
-*/
 
-            LCD.WriteLine(TimeNow()-veryStart);
-            } //yep
+//segment6 flips the switch and goes to the charger
+Step switchAndCharger[] = {
+    { "Wait", stepDelay, .5 },
+
+    //Turn to face the switch
+    { "Forward", stepForward, 4 },
+    { "Turn", stepPivotLeft },
+    { "Turn", stepPivotLeft },
+    { "Stop", stepStop },
+
+    //Drive to switch then turn it
+    { "To switch", stepRoute, ROUTE_TO_SWITCH },
+
+    //Need to test this area more
+    { "Backward", stepBackward, 15 },
+    { "Flip switch", stepRightSwing, -60, 25 },
+
+    { "Turn", stepPivotRight },
+    { "Swing back", stepRightSwing, -40, 18 },
+    { "Wait", stepDelay, 0.8 },
+
+    // Oven and charger if there's time for them
+    { "Optional", stepObjectives },
+};
+
+Segment segments[] = {
+    { "Pin and skid", pinAndSkid, sizeof(pinAndSkid) / sizeof(Step) },
+    { "Read light", readLight, sizeof(readLight) / sizeof(Step) },
+    { "Drop skid", dropSkid, sizeof(dropSkid) / sizeof(Step) },
+    { "Drop scoop", dropScoop, sizeof(dropScoop) / sizeof(Step) },
+    { "Up ramp", upRamp, sizeof(upRamp) / sizeof(Step) },
+    { "Switch, charger", switchAndCharger, sizeof(switchAndCharger) / sizeof(Step) },
+};
+
+Mission course(segments, sizeof(segments) / sizeof(Segment));
+
+// ***********************TELEMETRY*************************************
+
+// Everything we record during a run, written to the SD card afterwards. The
+// whole run every TELEMETRY_PERIOD, and every tick of the last couple of
+// seconds before something gives up.
+TelemetryRecord runRecords[TELEMETRY_RECORDS];
+TelemetryRecord tickRecords[TELEMETRY_TICK_RECORDS];
+Telemetry telemetry(runRecords, TELEMETRY_RECORDS);
+Telemetry tickTelemetry(tickRecords, TELEMETRY_TICK_RECORDS);
+
+// Squeeze a number into a telemetry field
+int clampRecord(float value, int low, int high)
+{
+    if(value < low) return low;
+    if(value > high) return high;
+    return (int)value;
+}
+
+// Samples the sensors and motor commands into the ring buffer
+class TelemetryTask : public Task
+{
+public:
+    // Start recording a new run
+    void restart()
+    {
+        telemetry.clear();
+        tickTelemetry.clear();
+        startTime = TimeNow();
+        lastRecord = startTime - TELEMETRY_PERIOD;
+    }
+
+    bool update()
+    {
+        TelemetryRecord record;
+        record.time = (inputs.time - startTime) * 1000;
+        record.leftCounts = leftWheel.counts();
+        record.rightCounts = rightWheel.counts();
+        record.liftCounts = liftShaft.counts();
+        record.cds = clampRecord(light.latest() * 1000, 0, 65535);
+        record.rpsX = clampRecord(RPS.X() * 10, -32768, 32767);
+        record.rpsY = clampRecord(RPS.Y() * 10, -32768, 32767);
+        record.rpsHeading = clampRecord(RPS.Heading() * 10, -32768, 32767);
+        record.leftPercent = clampRecord(leftMotor.Percent(), -100, 100);
+        record.rightPercent = clampRecord(rightMotor.Percent(), -100, 100);
+        record.liftPercent = clampRecord(liftMotor.Percent(), -100, 100);
+        record.battery = clampRecord(compensation.volts() * 1000, 0, 65535);
+        record.scale = clampRecord(compensation.scale() * 1000, 0, 65535);
+
+        record.switches = 0;
+        if(inputs.backLeft.pressed()) record.switches |= TELEMETRY_BACK_LEFT;
+        if(inputs.backRight.pressed()) record.switches |= TELEMETRY_BACK_RIGHT;
+        if(inputs.liftBottom.pressed()) record.switches |= TELEMETRY_LIFT_BOTTOM;
+
+        record.segment = course.currentSegment();
+        record.step = course.currentStep();
+
+        tickTelemetry.add(record);
+        if(inputs.time - lastRecord >= TELEMETRY_PERIOD)
+        {
+            telemetry.add(record);
+            lastRecord = inputs.time;
+        }
+        return false;
+    }
+
+private:
+    double startTime;
+    double lastRecord;
+};
+
+TelemetryTask telemetryTask;
+
+// Puts where we are in the mission and on the course up on the display
+class StatusTask : public Task
+{
+public:
+    bool update()
+    {
+        int segment = course.currentSegment();
+        int step = course.currentStep();
+        if(planner.currentStep()) display.set(ROW_STEP, planner.currentStep()->name);
+        else if(segment >= 0) display.set(ROW_STEP, segments[segment].steps[step].name);
+
+        display.set(ROW_TIME, "Time", course.elapsed());
+        display.set(ROW_X, "X", pose.x());
+        display.set(ROW_Y, "Y", pose.y());
+        display.set(ROW_HEADING, "Heading", pose.heading());
+        return false;
+    }
+};
+
+StatusTask statusTask;
+
+//---------------------------------------------------------------------------------------------------------
+
+//START MAIN
+
+// Main function
+int main(void)
+{
+    // Everything from here on goes into the trace
+    if(RECORD_TRACE) sensorTrace.start();
+
+    // Use the calibration profile and tuned settings if the robot has them
+    loadCalibration(CALIBRATION_FILE, calibration);
+    loadTuning(TUNING_FILE, tuning);
+    planner.load(PLAN_FILE);
+
+    // Configure shaft encoders
+    leftEncoder.SetThresholds(calibration.encoderLow, calibration.encoderHigh);
+    rightEncoder.SetThresholds(calibration.encoderLow, calibration.encoderHigh);
+    liftEncoder.SetThresholds(calibration.liftLow, calibration.liftHigh);
+
+    // Reset screen
+    LCD.Clear(FEHLCD::Black);
+    LCD.SetFontColor(FEHLCD::White);
+
+    // Initialize the positioning system
+     RPS.InitializeMenu();
+     RPS.Enable();
+
+    // Scale the motors to the pack from the first command
+    if(BATTERY_COMPENSATION)
+    {
+        compensation.update(battery.Voltage(), TimeNow());
+        leftMotor.compensate(&compensation);
+        rightMotor.compensate(&compensation);
+        liftMotor.compensate(&compensation);
+    }
+
+    // Read the encoders, switches and the CdS cell first thing every tick,
+    // and check the motors for jams
+    scheduler.addService(&inputTask);
+    scheduler.addService(&batteryTask);
+    scheduler.addService(&stallTask);
+    scheduler.addService(&light);
+
+    // The lift moves on its own once it has a target
+    scheduler.addService(&lift);
+
+    // Keep track of where we are from now on
+    scheduler.addService(&poseTask);
+
+    // Record every run
+    telemetryTask.restart();
+    scheduler.addService(&telemetryTask);
+
+    // Keep the screen up to date without holding up the control loops (an LCD
+    // write takes a few ms, so it goes after the tasks have reacted)
+    scheduler.addService(&statusTask);
+    scheduler.addLateService(&display);
+
+    //
+    // SPACE FOR ERROR LOGGING AND NOTES
+    //
+    //
+    //
+    // Main program loop
+    while(true)
+    {
+        // Pick a segment on the buttons (middle on its own runs the whole course)
+        int first = course.choose(buttons, "Calibrate");
+        if(first == course.count())
+        {
+            calibrate();
+            continue;
+        }
+
+        telemetryTask.restart();
+        givenUp = 0;
+        display.clear();
+        course.run(first);
+
+        // Make sure nothing is left moving
+        scheduler.waitAll();
+        liftWait();
+        stop();
+        sensorTrace.endTick();
+
+        course.report();
+        if(bumpReaction.count() > 0)
+        {
+            LCD.Write("Bump reaction ms ");
+            LCD.WriteLine((float)(bumpReaction.worst() * 1000));
+        }
+
+        if(compensation.known())
+        {
+            LCD.Write("Lowest battery V ");
+            LCD.WriteLine(compensation.lowest());
+            LCD.Write("Most motor scale ");
+            LCD.WriteLine(compensation.highestScale());
+        }
+
+        LCD.Write("Optional points ");
+        LCD.WriteLine(planner.scored());
+        LCD.Write("Moves given up ");
+        LCD.WriteLine(givenUp);
+
+        // Save the run for the decoder, and what the objectives took for the next plan
+        if(!planner.save(PLAN_FILE)) LCD.WriteLine("Plan not saved");
+        if(!telemetry.dump(TELEMETRY_FILE) || !tickTelemetry.dump(TELEMETRY_TICK_FILE)) LCD.WriteLine("Telemetry not saved");
+        if(sensorTrace.recording() && !sensorTrace.dump(TRACE_FILE)) LCD.WriteLine("Trace not saved");
+        if(sensorTrace.full()) LCD.WriteLine("Trace full");
+    }
 }
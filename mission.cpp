@@ -0,0 +1,176 @@
+#include "mission.h"
+#include <FEHLCD.h>
+#include <FEHUtility.h>
+
+// How many of the slowest steps to list after a run
+#define SLOW_STEPS_SHOWN 5
+
+Mission::Mission(Segment *segments, int numSegments)
+{
+    this->segments = segments;
+    this->numSegments = numSegments < MAX_SEGMENTS ? numSegments : MAX_SEGMENTS;
+
+    for(int i = 0; i < MAX_SEGMENTS; i++)
+    {
+        segmentTimes[i] = -1;
+        for(int j = 0; j < MAX_SEGMENT_STEPS; j++) stepTimes[i][j] = -1;
+    }
+    clockStart = 0;
+    runTime = 0;
+    segment = -1;
+    step = -1;
+}
+
+int Mission::choose(TracedButtons &buttons, const char *extra)
+{
+    int segment = 0;
+    int numChoices = extra ? numSegments + 1 : numSegments;
+
+    while(true)
+    {
+        LCD.Clear(FEHLCD::Black);
+        LCD.WriteLine("Start at segment:");
+        LCD.Write(segment + 1);
+        LCD.Write(" ");
+        LCD.WriteLine(segment < numSegments ? segments[segment].name : extra);
+        LCD.WriteLine("L/R change, M go");
+
+        // Wait for a button, then for it to be let go
+        while(!buttons.LeftPressed() && !buttons.MiddlePressed() && !buttons.RightPressed());
+
+        if(buttons.MiddlePressed())
+        {
+            while(buttons.MiddlePressed());
+            return segment;
+        }
+        if(buttons.LeftPressed())
+        {
+            while(buttons.LeftPressed());
+            segment = (segment + numChoices - 1) % numChoices;
+        }
+        else
+        {
+            while(buttons.RightPressed());
+            segment = (segment + 1) % numChoices;
+        }
+    }
+}
+
+void Mission::run(int first)
+{
+    // Forget the last run
+    for(int i = 0; i < MAX_SEGMENTS; i++)
+    {
+        segmentTimes[i] = -1;
+        for(int j = 0; j < MAX_SEGMENT_STEPS; j++) stepTimes[i][j] = -1;
+    }
+
+    startClock();
+
+    for(segment = first; segment < numSegments; segment++)
+    {
+        Segment &current = segments[segment];
+        double segmentStart = TimeNow();
+
+        for(step = 0; step < current.numSteps; step++)
+        {
+            Step &action = current.steps[step];
+            double stepStart = TimeNow();
+
+            action.action(action.a, action.b, action.c);
+
+            if(step < MAX_SEGMENT_STEPS) stepTimes[segment][step] = TimeNow() - stepStart;
+        }
+
+        segmentTimes[segment] = TimeNow() - segmentStart;
+    }
+
+    segment = -1;
+    step = -1;
+    runTime = elapsed();
+}
+
+void Mission::startClock()
+{
+    clockStart = TimeNow();
+}
+
+double Mission::elapsed() const
+{
+    return TimeNow() - clockStart;
+}
+
+const WaitPlan *Mission::currentPlan() const
+{
+    if(segment < 0 || step < 0) return 0;
+    return segments[segment].steps[step].plan;
+}
+
+float Mission::stepTime(int segment, int step) const
+{
+    if(segment < 0 || segment >= MAX_SEGMENTS || step < 0 || step >= MAX_SEGMENT_STEPS) return -1;
+    return stepTimes[segment][step];
+}
+
+float Mission::segmentTime(int segment) const
+{
+    if(segment < 0 || segment >= MAX_SEGMENTS) return -1;
+    return segmentTimes[segment];
+}
+
+void Mission::report() const
+{
+    LCD.Clear(FEHLCD::Black);
+    LCD.Write("Total ");
+    LCD.WriteLine(runTime);
+
+    for(int i = 0; i < numSegments; i++)
+    {
+        if(segmentTimes[i] < 0) continue;
+        LCD.Write(segments[i].name);
+        LCD.Write(" ");
+        LCD.WriteLine(segmentTimes[i]);
+    }
+
+    // Pick out the slowest steps, skipping ones already shown (steps can take
+    // exactly as long as each other, so it goes by which ones, not the time)
+    int shownSegment[SLOW_STEPS_SHOWN], shownStep[SLOW_STEPS_SHOWN];
+    int shown = 0;
+    while(shown < SLOW_STEPS_SHOWN)
+    {
+        int slowSegment = -1, slowStep = -1;
+        float slowTime = -1;
+        for(int i = 0; i < numSegments; i++)
+        {
+            for(int j = 0; j < segments[i].numSteps && j < MAX_SEGMENT_STEPS; j++)
+            {
+                float time = stepTimes[i][j];
+                if(time <= slowTime) continue;
+
+                bool already = false;
+                for(int k = 0; k < shown; k++)
+                {
+                    if(shownSegment[k] == i && shownStep[k] == j) already = true;
+                }
+                if(already) continue;
+
+                slowTime = time;
+                slowSegment = i;
+                slowStep = j;
+            }
+        }
+        if(slowSegment < 0) break;
+
+        LCD.Write(slowSegment + 1);
+        LCD.Write(".");
+        LCD.Write(slowStep + 1);
+        LCD.Write(" ");
+        LCD.Write(segments[slowSegment].steps[slowStep].name);
+        LCD.Write(" ");
+        LCD.WriteLine(slowTime);
+
+        shownSegment[shown] = slowSegment;
+        shownStep[shown] = slowStep;
+        shown++;
+    }
+}
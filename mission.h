@@ -0,0 +1,85 @@
+#ifndef MISSION_H
+#define MISSION_H
+
+#include "trace.h"
+
+// Room for timings
+#define MAX_SEGMENTS 10
+#define MAX_SEGMENT_STEPS 64
+
+struct WaitPlan;
+
+// Every primitive in the table takes the same three numbers, a step just
+// ignores the ones it doesn't need
+typedef void (*StepAction)(float a, float b, float c);
+
+// One line of the mission: what to do and the numbers to do it with. A step
+// can bring its own deadline and recoveries, otherwise the primitive's are used.
+struct Step
+{
+    const char *name;
+    StepAction action;
+    float a;
+    float b;
+    float c;
+    const WaitPlan *plan;
+};
+
+// A named run of steps that can be started on its own for practice
+struct Segment
+{
+    const char *name;
+    Step *steps;
+    int numSteps;
+};
+
+// Runs the mission table from any segment to the end and times every step
+class Mission
+{
+public:
+    Mission(Segment *segments, int numSegments);
+
+    // Let the operator pick a starting segment on the button board (left and
+    // right change it, middle starts), returns the segment number. An extra
+    // choice after the last segment can be offered, it comes back as the
+    // number of segments.
+    int choose(TracedButtons &buttons, const char *extra = 0);
+
+    // Number of segments in the course
+    int count() const { return numSegments; }
+
+    // Run every step from a segment to the end of the course
+    void run(int first);
+
+    // Restart the course clock (call when the start light comes on)
+    void startClock();
+
+    // Seconds since the course clock started
+    double elapsed() const;
+
+    // Segment and step running right now (-1 between runs)
+    int currentSegment() const { return segment; }
+    int currentStep() const { return step; }
+
+    // Wait plan the running step asked for (0 if none)
+    const WaitPlan *currentPlan() const;
+
+    // How long the last run of a step or segment took (-1 if it didn't run)
+    float stepTime(int segment, int step) const;
+    float segmentTime(int segment) const;
+
+    // Show the total, every segment time and the slowest steps on the LCD
+    void report() const;
+
+private:
+    Segment *segments;
+    int numSegments;
+    float stepTimes[MAX_SEGMENTS][MAX_SEGMENT_STEPS];
+    float segmentTimes[MAX_SEGMENTS];
+    double clockStart;
+    double runTime;
+    int segment;
+    int step;
+};
+
+#endif // MISSION_H
@@ -0,0 +1,48 @@
+#include "motionprofile.h"
+#include <cmath>
+
+MotionProfile::MotionProfile()
+{
+    plan(0, 0, 1, 0);
+}
+
+void MotionProfile::plan(float distance, float cruiseSpeed, float maxAccel, float minSpeed)
+{
+    this->distance = distance;
+    this->cruiseSpeed = cruiseSpeed;
+    this->maxAccel = maxAccel;
+    this->minSpeed = minSpeed;
+}
+
+float MotionProfile::speed(float elapsed, float travelled) const
+{
+    // Ramp up from a stop
+    float v = maxAccel * elapsed;
+
+    // Don't go over the cruise speed
+    if(v > cruiseSpeed) v = cruiseSpeed;
+
+    // Fastest speed we can still stop from in the distance left. This uses
+    // the real distance, not the planned one, so a slow start doesn't make
+    // us stop short.
+    float left = distance - travelled;
+    if(left < 0) left = 0;
+    float stopping = std::sqrt(2 * maxAccel * left);
+    if(v > stopping) v = stopping;
+
+    // Keep creeping so friction can't stall us short of the target
+    if(v < minSpeed) v = minSpeed;
+
+    return v;
+}
+
+float MotionProfile::duration() const
+{
+    float rampTime = cruiseSpeed / maxAccel;
+    float rampDistance = cruiseSpeed * rampTime / 2;
+
+    // Too short to reach cruise speed, ramp straight up then down
+    if(2 * rampDistance > distance) return 2 * std::sqrt(distance / maxAccel);
+
+    return 2 * rampTime + (distance - 2 * rampDistance) / cruiseSpeed;
+}
@@ -0,0 +1,29 @@
+#ifndef MOTIONPROFILE_H
+#define MOTIONPROFILE_H
+
+// Trapezoidal speed profile for a move of known length: ramp up at a set
+// acceleration, cruise, then ramp back down so we arrive on the target.
+// Distances are in encoder counts, speeds in counts per second.
+class MotionProfile
+{
+public:
+    MotionProfile();
+
+    // Set up a new move
+    void plan(float distance, float cruiseSpeed, float maxAccel, float minSpeed);
+
+    // Speed to command given the time since the move started and how far
+    // we have actually gone
+    float speed(float elapsed, float travelled) const;
+
+    // How long the move should take if we follow the profile
+    float duration() const;
+
+private:
+    float distance;
+    float cruiseSpeed;
+    float maxAccel;
+    float minSpeed;
+};
+
+#endif // MOTIONPROFILE_H
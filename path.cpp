@@ -0,0 +1,155 @@
+#include "path.h"
+#include "pose.h"
+#include <cmath>
+
+#define PI 3.14159265
+
+// Headings closer than this are the same line, and a goal that far off it
+// can still be reached with a straight
+#define PATH_ANGLE_TOLERANCE 0.5 // degrees
+#define PATH_LINE_TOLERANCE 0.5 // inches
+
+// Steps along the path when checking it against the walls
+#define PATH_CHECK_STEP 1.0 // inches
+
+Path::Path()
+{
+    numSegments = 0;
+}
+
+bool Path::add(float length, float curvature)
+{
+    // Leave out the pieces too short to drive
+    if(length < .01) return true;
+    if(numSegments >= MAX_PATH_SEGMENTS) return false;
+
+    segments[numSegments].length = length;
+    segments[numSegments].curvature = curvature;
+    numSegments++;
+    return true;
+}
+
+bool Path::plan(const CoursePose &from, const CoursePose *goals, int numGoals, float radius, float minRadius)
+{
+    numSegments = 0;
+    CoursePose at = from;
+
+    for(int i = 0; i < numGoals; i++)
+    {
+        const CoursePose &goal = goals[i];
+        float ux = std::cos(at.heading * PI / 180), uy = std::sin(at.heading * PI / 180);
+        float vx = std::cos(goal.heading * PI / 180), vy = std::sin(goal.heading * PI / 180);
+        float dx = goal.x - at.x, dy = goal.y - at.y;
+        float turn = angleDifference(goal.heading, at.heading);
+
+        if(std::abs(turn) < PATH_ANGLE_TOLERANCE)
+        {
+            // Same heading, the goal has to be straight ahead
+            float ahead = dx * ux + dy * uy;
+            float aside = dx * uy - dy * ux;
+            if(ahead < 0 || std::abs(aside) > PATH_LINE_TOLERANCE) return false;
+            if(!add(ahead, 0)) return false;
+        }
+        else
+        {
+            // Where our line crosses the goal's: s inches ahead of us and
+            // t inches behind the goal
+            float cross = ux * vy - uy * vx;
+            if(std::abs(cross) < 1e-3) return false;
+            float s = (dx * vy - dy * vx) / cross;
+            float t = (ux * dy - uy * dx) / cross;
+            if(s < 0 || t < 0) return false;
+
+            // Round the corner off with the biggest arc that fits
+            float half = std::tan(std::abs(turn) * PI / 360);
+            float r = radius;
+            if(s < r * half) r = s / half;
+            if(t < r * half) r = t / half;
+            if(r < minRadius) return false;
+
+            float curvature = (turn > 0 ? 1 : -1) / r;
+            if(!add(s - r * half, 0)) return false;
+            if(!add(r * std::abs(turn) * PI / 180, curvature)) return false;
+            if(!add(t - r * half, 0)) return false;
+        }
+
+        at = goal;
+    }
+    return true;
+}
+
+bool Path::clear(const CoursePose &from, float margin) const
+{
+    float x = from.x, y = from.y;
+    float heading = from.heading * PI / 180;
+    if(wallClearance(x, y) < margin) return false;
+
+    for(int i = 0; i < numSegments; i++)
+    {
+        const PathSegment &piece = segments[i];
+        int steps = std::ceil(piece.length / PATH_CHECK_STEP);
+        float step = piece.length / steps;
+
+        for(int j = 0; j < steps; j++)
+        {
+            // Move along the chord of each little bit of arc
+            float turn = step * piece.curvature;
+            x += step * std::cos(heading + turn / 2);
+            y += step * std::sin(heading + turn / 2);
+            heading += turn;
+            if(wallClearance(x, y) < margin) return false;
+        }
+    }
+    return true;
+}
+
+int Path::sample(const CoursePose &from, float spacing, CoursePose *points, int maxPoints) const
+{
+    if(maxPoints < 2) return 0;
+
+    float x = from.x, y = from.y;
+    float heading = from.heading * PI / 180;
+    int count = 0;
+    points[count++] = from;
+    bool skipped = false;
+
+    for(int i = 0; i < numSegments; i++)
+    {
+        const PathSegment &piece = segments[i];
+        int steps = std::ceil(piece.length / spacing);
+        float step = piece.length / steps;
+
+        for(int j = 0; j < steps; j++)
+        {
+            // Same chords as the wall check
+            float turn = step * piece.curvature;
+            x += step * std::cos(heading + turn / 2);
+            y += step * std::sin(heading + turn / 2);
+            heading += turn;
+
+            // Keep the last place for the goal if we run out of room
+            if(count < maxPoints - 1)
+            {
+                points[count].x = x;
+                points[count].y = y;
+                points[count].heading = wrapHeading(heading * 180 / PI);
+                count++;
+            }
+            else skipped = true;
+        }
+    }
+
+    // The goal goes in the place kept for it
+    if(skipped) count++;
+    points[count - 1].x = x;
+    points[count - 1].y = y;
+    points[count - 1].heading = wrapHeading(heading * 180 / PI);
+    return count;
+}
+
+float Path::length() const
+{
+    float total = 0;
+    for(int i = 0; i < numSegments; i++) total += segments[i].length;
+    return total;
+}
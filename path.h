@@ -0,0 +1,52 @@
+#ifndef PATH_H
+#define PATH_H
+
+#include "course.h"
+
+// Room for the pieces of one path (a goal takes up to three)
+#define MAX_PATH_SEGMENTS 24
+
+// One piece of a path. A curvature of 0 is a straight, otherwise it's an arc
+// of radius 1 / curvature, positive turning left.
+struct PathSegment
+{
+    float length; // inches
+    float curvature; // 1 / inches
+};
+
+// A path made of straights and arcs through a list of goal poses, so the
+// robot can drive it in one go instead of stopping to pivot at every corner.
+// Each goal is reached with a straight along our heading, one arc and a
+// straight along the goal's heading, so the two lines have to cross ahead of
+// us and behind the goal.
+class Path
+{
+public:
+    Path();
+
+    // Plan from a pose through the goals with arcs of radius up to radius,
+    // tighter where a corner needs it but never under minRadius. Returns
+    // false if some goal can't be reached that way.
+    bool plan(const CoursePose &from, const CoursePose *goals, int numGoals, float radius, float minRadius);
+
+    // True if the middle of the robot stays margin inches from every wall
+    bool clear(const CoursePose &from, float margin) const;
+
+    // Points along the path about spacing inches apart, starting with from
+    // and ending on the last goal. Returns how many it wrote.
+    int sample(const CoursePose &from, float spacing, CoursePose *points, int maxPoints) const;
+
+    int count() const { return numSegments; }
+    const PathSegment &segment(int i) const { return segments[i]; }
+
+    // Total length along the middle of the robot in inches
+    float length() const;
+
+private:
+    bool add(float length, float curvature);
+
+    PathSegment segments[MAX_PATH_SEGMENTS];
+    int numSegments;
+};
+
+#endif // PATH_H
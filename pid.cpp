@@ -0,0 +1,39 @@
+#include "pid.h"
+
+PID::PID(float kp, float ki, float kd, float outMin, float outMax)
+{
+    this->kp = kp;
+    this->ki = ki;
+    this->kd = kd;
+    this->outMin = outMin;
+    this->outMax = outMax;
+    reset();
+}
+
+void PID::reset()
+{
+    integral = 0;
+    lastError = 0;
+    first = true;
+}
+
+float PID::update(float error, float dt)
+{
+    if(dt <= 0) dt = 0.001;
+
+    // No derivative kick on the first sample
+    float derivative = first ? 0 : (error - lastError) / dt;
+    first = false;
+    lastError = error;
+
+    float output = kp * error + kd * derivative;
+
+    // Only integrate while the output isn't pinned against a limit
+    float newIntegral = integral + error * dt;
+    float withIntegral = output + ki * newIntegral;
+    if(withIntegral > outMax) return outMax;
+    if(withIntegral < outMin) return outMin;
+
+    integral = newIntegral;
+    return withIntegral;
+}
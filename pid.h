@@ -0,0 +1,24 @@
+#ifndef PID_H
+#define PID_H
+
+// Proportional-integral-derivative controller with a clamped output
+class PID
+{
+public:
+    PID(float kp, float ki, float kd, float outMin, float outMax);
+
+    // Forget the integral and last error (call before each new move)
+    void reset();
+
+    // Feed the error for this tick and get the controller output
+    float update(float error, float dt);
+
+private:
+    float kp, ki, kd;
+    float outMin, outMax;
+    float integral;
+    float lastError;
+    bool first;
+};
+
+#endif // PID_H
@@ -0,0 +1,173 @@
+#include "planner.h"
+#include <FEHSD.h>
+#include <FEHUtility.h>
+
+Planner::Planner(Objective *objectives, int numObjectives)
+{
+    this->objectives = objectives;
+    this->numObjectives = numObjectives < MAX_OBJECTIVES ? numObjectives : MAX_OBJECTIVES;
+
+    for(int i = 0; i < MAX_OBJECTIVES; i++)
+    {
+        goesAllowed[i] = 1;
+        goesPlanned[i] = 0;
+        trial[i] = 0;
+        for(int j = 0; j < MAX_OBJECTIVE_STEPS; j++)
+        {
+            estimates[i][j] = 0;
+            timed[i][j] = false;
+        }
+    }
+    running = 0;
+    points = 0;
+    bestPoints = 0;
+    bestTime = 0;
+}
+
+void Planner::setGoes(int objective, int goes)
+{
+    if(objective < 0 || objective >= numObjectives) return;
+    goesAllowed[objective] = goes > 0 ? goes : 0;
+}
+
+double Planner::stepEstimate(int objective, int step) const
+{
+    if(timed[objective][step]) return estimates[objective][step];
+
+    // Until it has been timed every step gets an even share of the guess
+    const Objective &current = objectives[objective];
+    return current.guess / current.numSteps;
+}
+
+double Planner::estimate(int objective, int goes) const
+{
+    if(objective < 0 || objective >= numObjectives || goes <= 0) return 0;
+
+    const Objective &current = objectives[objective];
+    double seconds = 0;
+    for(int i = 0; i < current.numSteps && i < MAX_OBJECTIVE_STEPS; i++)
+    {
+        seconds += stepEstimate(objective, i) * (i == current.repeat ? goes - 1 : 1);
+    }
+    return seconds;
+}
+
+void Planner::learn(int objective, int step, double seconds)
+{
+    if(step >= MAX_OBJECTIVE_STEPS) return;
+
+    if(!timed[objective][step]) estimates[objective][step] = seconds;
+    else estimates[objective][step] += (seconds - estimates[objective][step]) * PLAN_LEARN;
+    timed[objective][step] = true;
+}
+
+// Tries every objective done and left out, there are only a handful. Part of
+// an objective scores nothing, so it's all its goes or none of them.
+void Planner::search(int objective, double budget, int points, double time)
+{
+    if(time > budget) return;
+
+    if(objective == numObjectives)
+    {
+        if(points > bestPoints || (points == bestPoints && time < bestTime))
+        {
+            bestPoints = points;
+            bestTime = time;
+            for(int i = 0; i < numObjectives; i++) goesPlanned[i] = trial[i];
+        }
+        return;
+    }
+
+    trial[objective] = 0;
+    search(objective + 1, budget, points, time);
+
+    int goes = goesAllowed[objective];
+    if(goes > 0)
+    {
+        trial[objective] = goes;
+        search(objective + 1, budget, points + objectives[objective].points, time + estimate(objective, goes));
+        trial[objective] = 0;
+    }
+}
+
+int Planner::plan(int first, double budget)
+{
+    // Leaving everything out always fits
+    bestPoints = 0;
+    bestTime = 0;
+    for(int i = 0; i < numObjectives; i++)
+    {
+        goesPlanned[i] = 0;
+        trial[i] = 0;
+    }
+
+    search(first, budget, 0, 0);
+    return bestPoints;
+}
+
+void Planner::run(const Mission &course, double timeLimit)
+{
+    points = 0;
+
+    for(int i = 0; i < numObjectives; i++)
+    {
+        // Plan again every time, the last one may not have taken what we thought
+        plan(i, timeLimit - course.elapsed());
+        int goes = goesPlanned[i];
+        if(goes == 0) continue;
+
+        Objective &objective = objectives[i];
+        for(int j = 0; j < objective.numSteps && j < MAX_OBJECTIVE_STEPS; j++)
+        {
+            Step &step = objective.steps[j];
+            running = &step;
+
+            int times = j == objective.repeat ? goes - 1 : 1;
+            for(int k = 0; k < times; k++)
+            {
+                double stepStart = TimeNow();
+                step.action(step.a, step.b, step.c);
+                learn(i, j, TimeNow() - stepStart);
+            }
+        }
+        running = 0;
+
+        points += objective.points;
+    }
+}
+
+bool Planner::load(const char *name)
+{
+    FEHFile *file = SD.FOpen(name, "r");
+    if(!file) return false;
+
+    // One "objective step seconds" line for every step that has been timed
+    int objective, step;
+    float seconds;
+    while(!SD.FEof(file) && SD.FScanf(file, "%d %d %f", &objective, &step, &seconds) == 3)
+    {
+        if(objective < 0 || objective >= numObjectives || step < 0 || step >= MAX_OBJECTIVE_STEPS) continue;
+        estimates[objective][step] = seconds;
+        timed[objective][step] = true;
+    }
+
+    SD.FClose(file);
+    return true;
+}
+
+bool Planner::save(const char *name) const
+{
+    FEHFile *file = SD.FOpen(name, "w");
+    if(!file) return false;
+
+    for(int i = 0; i < numObjectives; i++)
+    {
+        for(int j = 0; j < MAX_OBJECTIVE_STEPS; j++)
+        {
+            if(timed[i][j]) SD.FPrintf(file, "%d %d %f\n", i, j, estimates[i][j]);
+        }
+    }
+
+    SD.FClose(file);
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include "mission.h"
+
+// Room for the optional end of the course
+#define MAX_OBJECTIVES 8
+#define MAX_OBJECTIVE_STEPS 16
+
+// How far one timed run moves a step's estimate toward what it took (0..1)
+#define PLAN_LEARN 0.5
+
+// File the step estimates are kept in on the SD card
+#define PLAN_FILE "PLAN.TXT"
+
+// Something worth points that can be left out when time is short. The
+// objectives come in the order the route takes them and each one starts
+// where the last one done left the robot, so one that gets left out has to
+// leave the next one somewhere it can start from.
+struct Objective
+{
+    const char *name;
+    Step *steps;
+    int numSteps;
+    int repeat; // step done again for every go after the first (-1 if none)
+    int points; // for doing it with every go it asks for, there's nothing for part of it
+    float guess; // seconds for one go before it has been timed
+};
+
+// Picks which objectives fit in the time left on the course clock and runs
+// them, timing every step so the next plan knows better
+class Planner
+{
+public:
+    Planner(Objective *objectives, int numObjectives);
+
+    // Goes an objective takes to score (1 unless set, 0 leaves it out)
+    void setGoes(int objective, int goes);
+
+    // Seconds an objective should take for a number of goes
+    double estimate(int objective, int goes) const;
+
+    // Pick which objectives from first on get done, with all their goes,
+    // for the most points in the budget and the fewest seconds on a tie.
+    // Returns the points.
+    int plan(int first, double budget);
+
+    // Goes the last plan gave an objective
+    int planned(int objective) const { return goesPlanned[objective]; }
+
+    // Run the objectives, planning again before each one with whatever is
+    // left of the time limit on the course clock
+    void run(const Mission &course, double timeLimit);
+
+    // The objective step running right now (0 if none)
+    const Step *currentStep() const { return running; }
+
+    // Points from the objectives done in the last run
+    int scored() const { return points; }
+
+    // Read the step estimates over the guesses, returns false if there's no file
+    bool load(const char *name);
+
+    // Write the step estimates, returns false if the card couldn't be written
+    bool save(const char *name) const;
+
+private:
+    double stepEstimate(int objective, int step) const;
+    void learn(int objective, int step, double seconds);
+    void search(int objective, double budget, int points, double time);
+
+    Objective *objectives;
+    int numObjectives;
+    int goesAllowed[MAX_OBJECTIVES];
+    int goesPlanned[MAX_OBJECTIVES];
+    float estimates[MAX_OBJECTIVES][MAX_OBJECTIVE_STEPS];
+    bool timed[MAX_OBJECTIVES][MAX_OBJECTIVE_STEPS];
+    const Step *running;
+    int points;
+
+    // Best found so far while searching
+    int trial[MAX_OBJECTIVES];
+    int bestPoints;
+    double bestTime;
+};
+
+#endif // PLANNER_H
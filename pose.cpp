@@ -0,0 +1,101 @@
+#include "pose.h"
+#include <cmath>
+
+// How much worse dead reckoning gets for every inch the wheels roll
+#define ODOMETRY_POSITION_NOISE 0.02 // square inches per inch
+#define ODOMETRY_HEADING_NOISE 0.5 // square degrees per inch
+
+// How much we trust a single RPS fix
+#define RPS_POSITION_NOISE 0.25 // square inches
+#define RPS_HEADING_NOISE 4.0 // square degrees
+
+// Fixes further out than this many standard deviations are glitches, unless
+// we keep getting them in a row (then it's us that is lost)
+#define RPS_GATE 4.0
+#define RPS_MAX_REJECTS 5
+
+#define PI 3.14159265
+
+float angleDifference(float to, float from)
+{
+    float difference = std::fmod(to - from, (float)DEGREES_PER_TURN);
+    if(difference >= DEGREES_PER_TURN / 2) difference -= DEGREES_PER_TURN;
+    if(difference < -DEGREES_PER_TURN / 2) difference += DEGREES_PER_TURN;
+    return difference;
+}
+
+float wrapHeading(float heading)
+{
+    heading = std::fmod(heading, (float)DEGREES_PER_TURN);
+    if(heading < 0) heading += DEGREES_PER_TURN;
+    return heading;
+}
+
+PoseEstimator::PoseEstimator()
+{
+    // Until the first fix we have no idea where we are
+    reset(0, 0, 0, 1e6, 1e6);
+}
+
+void PoseEstimator::reset(float x, float y, float heading, float positionVariance, float headingVariance)
+{
+    px = x;
+    py = y;
+    ph = wrapHeading(heading);
+    vx = positionVariance;
+    vy = positionVariance;
+    vh = headingVariance;
+    rejects = 0;
+}
+
+void PoseEstimator::addOdometry(float leftDistance, float rightDistance, float wheelBase)
+{
+    float distance = (leftDistance + rightDistance) / 2;
+    float turn = (rightDistance - leftDistance) / wheelBase * 180 / PI;
+
+    // Move along the heading half way through the turn
+    float middle = (ph + turn / 2) * PI / 180;
+    px += distance * std::cos(middle);
+    py += distance * std::sin(middle);
+    ph = wrapHeading(ph + turn);
+
+    // The more the wheels roll the less we trust dead reckoning
+    float rolled = std::fabs(leftDistance) + std::fabs(rightDistance);
+    vx += ODOMETRY_POSITION_NOISE * rolled;
+    vy += ODOMETRY_POSITION_NOISE * rolled;
+    vh += ODOMETRY_HEADING_NOISE * rolled;
+}
+
+bool PoseEstimator::addFix(float fixX, float fixY, float fixHeading)
+{
+    float errorX = fixX - px;
+    float errorY = fixY - py;
+    float errorHeading = angleDifference(fixHeading, ph);
+
+    // Throw out fixes that can't be right
+    if(errorX * errorX > RPS_GATE * RPS_GATE * (vx + RPS_POSITION_NOISE) ||
+       errorY * errorY > RPS_GATE * RPS_GATE * (vy + RPS_POSITION_NOISE) ||
+       errorHeading * errorHeading > RPS_GATE * RPS_GATE * (vh + RPS_HEADING_NOISE))
+    {
+        if(++rejects < RPS_MAX_REJECTS) return false;
+
+        // RPS keeps disagreeing, start over from it
+        reset(fixX, fixY, fixHeading, RPS_POSITION_NOISE, RPS_HEADING_NOISE);
+        return true;
+    }
+    rejects = 0;
+
+    // Weigh the fix against our estimate by how much we trust each
+    float gainX = vx / (vx + RPS_POSITION_NOISE);
+    float gainY = vy / (vy + RPS_POSITION_NOISE);
+    float gainHeading = vh / (vh + RPS_HEADING_NOISE);
+
+    px += gainX * errorX;
+    py += gainY * errorY;
+    ph = wrapHeading(ph + gainHeading * errorHeading);
+
+    vx *= 1 - gainX;
+    vy *= 1 - gainY;
+    vh *= 1 - gainHeading;
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef POSE_H
+#define POSE_H
+
+// Course position and heading, in RPS units (inches and degrees, heading
+// counterclockwise with 0 along the x axis)
+#define DEGREES_PER_TURN 360.0
+
+// Wrap an angle difference into -180..180 degrees
+float angleDifference(float to, float from);
+
+// Wrap a heading into 0..360 degrees
+float wrapHeading(float heading);
+
+// Estimates where the robot is by dead reckoning on the wheel encoders every
+// tick and blending in RPS fixes whenever we get them. Each of x, y and the
+// heading is treated as its own one dimensional Kalman filter, so along with
+// the estimate we keep a variance that says how much to trust it.
+class PoseEstimator
+{
+public:
+    PoseEstimator();
+
+    // Start over from a known pose (a huge variance means "no idea yet")
+    void reset(float x, float y, float heading, float positionVariance, float headingVariance);
+
+    // Dead reckon from how far each wheel rolled in inches (backward is negative)
+    void addOdometry(float leftDistance, float rightDistance, float wheelBase);
+
+    // Blend in an RPS fix, returns false if it was thrown out as a glitch
+    bool addFix(float fixX, float fixY, float fixHeading);
+
+    float x() const { return px; }
+    float y() const { return py; }
+    float heading() const { return ph; }
+
+    // Covariance of the estimate (the filter keeps it diagonal)
+    float varianceX() const { return vx; }
+    float varianceY() const { return vy; }
+    float varianceHeading() const { return vh; }
+
+private:
+    float px, py, ph;
+    float vx, vy, vh;
+    int rejects;
+};
+
+#endif // POSE_H
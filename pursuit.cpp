@@ -0,0 +1,108 @@
+#include "pursuit.h"
+#include <cmath>
+
+#define PI 3.14159265
+
+PurePursuit::PurePursuit()
+{
+    numPoints = 0;
+    piece = 0;
+    along = 0;
+    lastOffset = 0;
+}
+
+void PurePursuit::set(const CoursePose *points, int numPoints)
+{
+    this->numPoints = 0;
+    for(int i = 0; i < numPoints && this->numPoints < MAX_PURSUIT_POINTS; i++)
+    {
+        if(this->numPoints > 0)
+        {
+            float dx = points[i].x - px[this->numPoints - 1], dy = points[i].y - py[this->numPoints - 1];
+            float length = std::sqrt(dx * dx + dy * dy);
+            if(length < .01) continue;
+            pieceLength[this->numPoints - 1] = length;
+        }
+        px[this->numPoints] = points[i].x;
+        py[this->numPoints] = points[i].y;
+        this->numPoints++;
+    }
+
+    piece = 0;
+    along = 0;
+    lastOffset = 0;
+}
+
+// Move our place to the nearest point on the line from here on, so we never
+// skip back to a piece we already drove (the line can cross itself)
+void PurePursuit::place(float x, float y)
+{
+    float closest = 1e9;
+    int bestPiece = piece;
+    float bestAlong = along;
+
+    for(int i = piece; i < numPoints - 1; i++)
+    {
+        float ux = (px[i + 1] - px[i]) / pieceLength[i], uy = (py[i + 1] - py[i]) / pieceLength[i];
+        float t = (x - px[i]) * ux + (y - py[i]) * uy;
+
+        // The last piece runs on past the end
+        if(t < 0) t = 0;
+        if(t > pieceLength[i] && i < numPoints - 2) t = pieceLength[i];
+        if(i == piece && t < along) t = along;
+
+        float ex = px[i] + t * ux - x, ey = py[i] + t * uy - y;
+        float distance = std::sqrt(ex * ex + ey * ey);
+        if(distance < closest)
+        {
+            closest = distance;
+            bestPiece = i;
+            bestAlong = t;
+        }
+    }
+
+    piece = bestPiece;
+    along = bestAlong;
+    lastOffset = closest;
+}
+
+float PurePursuit::curvature(float x, float y, float heading, float lookahead)
+{
+    if(numPoints < 2) return 0;
+    place(x, y);
+
+    // Walk the lookahead on from our place
+    int i = piece;
+    float t = along + lookahead;
+    while(i < numPoints - 2 && t > pieceLength[i])
+    {
+        t -= pieceLength[i];
+        i++;
+    }
+    float ux = (px[i + 1] - px[i]) / pieceLength[i], uy = (py[i + 1] - py[i]) / pieceLength[i];
+    float gx = px[i] + t * ux, gy = py[i] + t * uy;
+
+    // The goal point as seen from the robot, then the arc through it
+    float angle = heading * PI / 180;
+    float dx = gx - x, dy = gy - y;
+    float sideways = -std::sin(angle) * dx + std::cos(angle) * dy;
+    float squared = dx * dx + dy * dy;
+    if(squared < 1e-6) return 0;
+    return 2 * sideways / squared;
+}
+
+float PurePursuit::remaining() const
+{
+    if(numPoints < 2) return 0;
+
+    float left = -along;
+    for(int i = piece; i < numPoints - 1; i++) left += pieceLength[i];
+    return left;
+}
+
+float PurePursuit::length() const
+{
+    float total = 0;
+    for(int i = 0; i < numPoints - 1; i++) total += pieceLength[i];
+    return total;
+}
@@ -0,0 +1,48 @@
+#ifndef PURSUIT_H
+#define PURSUIT_H
+
+#include "course.h"
+
+// Most points in a line to follow
+#define MAX_PURSUIT_POINTS 64
+
+// Pure pursuit along a line of course points. Every tick it finds where the
+// robot is along the line, picks the point a lookahead distance further on
+// and gives the curvature of the arc from the robot through that point.
+// Steering on the pose instead of on counted wheel turns means drift gets
+// taken out as we go, not by a stop and a square at the end. Past the end
+// the line carries on straight, so we arrive lined up with the last piece.
+class PurePursuit
+{
+public:
+    PurePursuit();
+
+    // Follow a line, the first point is where it starts (usually where we
+    // are). Points closer together than a hundredth of an inch are dropped.
+    void set(const CoursePose *points, int numPoints);
+
+    // Curvature to steer on from a pose, 1 / inches and positive to the
+    // left. Also moves our place along the line up to the pose.
+    float curvature(float x, float y, float heading, float lookahead);
+
+    // Inches along the line from our place to the end (negative once we are past it)
+    float remaining() const;
+
+    // Length of the whole line
+    float length() const;
+
+    // How far the robot is from the line right now
+    float offset() const { return lastOffset; }
+
+private:
+    void place(float x, float y);
+
+    float px[MAX_PURSUIT_POINTS], py[MAX_PURSUIT_POINTS];
+    float pieceLength[MAX_PURSUIT_POINTS];
+    int numPoints;
+    int piece; // piece of the line we're on, from point piece to piece + 1
+    float along; // inches along that piece
+    float lastOffset;
+};
+
+#endif // PURSUIT_H
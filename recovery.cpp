@@ -0,0 +1,16 @@
+#include "recovery.h"
+
+bool waitFor(Task *task, const WaitPlan &plan)
+{
+    for(int i = 0; ; i++)
+    {
+        if(scheduler.runFor(task, plan.deadline, plan.stuck)) return true;
+
+        // Out of ideas, skip it
+        if(i >= MAX_RECOVERIES || plan.recover[i] == 0) return false;
+
+        // Try to get unstuck, then have another go from where we got to
+        scheduler.run(plan.recover[i]);
+        task->retry();
+    }
+}
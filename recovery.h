@@ -0,0 +1,23 @@
+#ifndef RECOVERY_H
+#define RECOVERY_H
+
+#include "scheduler.h"
+
+// Most recoveries one plan can list
+#define MAX_RECOVERIES 4
+
+// How long a blocking wait may take and what to try when it runs out. The
+// recoveries are tasks that run in order, one after each timeout or stall,
+// and the wait gets another go after each one. Once the list runs out (or
+// hits a 0) the wait gives up so the course can carry on with the next step.
+struct WaitPlan
+{
+    float deadline; // seconds allowed on top of what the task expects to take
+    Task *recover[MAX_RECOVERIES];
+    bool (*stuck)(); // ends the wait early when it says so (0 to only go by the deadline)
+};
+
+// Run a task under a plan, returns false if it had to give up on it
+bool waitFor(Task *task, const WaitPlan &plan);
+
+#endif // RECOVERY_H
@@ -0,0 +1,159 @@
+#include "scheduler.h"
+#include <FEHUtility.h>
+
+// The one scheduler shared by the whole program
+Scheduler scheduler;
+
+Task::Task()
+{
+    active = false;
+}
+
+Scheduler::Scheduler()
+{
+    for(int i = 0; i < MAX_TASKS; i++) tasks[i] = 0;
+    for(int i = 0; i < MAX_SERVICES; i++) services[i] = 0;
+    for(int i = 0; i < MAX_SERVICES; i++) lateServices[i] = 0;
+    numServices = 0;
+    numLateServices = 0;
+    nextTick = 0;
+    tickStart = 0;
+}
+
+bool Scheduler::add(Task *task)
+{
+    // Starting a task that is already going restarts it
+    if(task->active) cancel(task);
+
+    for(int i = 0; i < MAX_TASKS; i++)
+    {
+        if(tasks[i] == 0)
+        {
+            tasks[i] = task;
+            task->active = true;
+            task->start();
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scheduler::cancel(Task *task)
+{
+    for(int i = 0; i < MAX_TASKS; i++)
+    {
+        if(tasks[i] == task)
+        {
+            tasks[i] = 0;
+            task->active = false;
+            task->finish();
+        }
+    }
+}
+
+bool Scheduler::addService(Task *service)
+{
+    if(numServices >= MAX_SERVICES) return false;
+
+    services[numServices++] = service;
+    service->active = true;
+    service->start();
+    return true;
+}
+
+bool Scheduler::addLateService(Task *service)
+{
+    if(numLateServices >= MAX_SERVICES) return false;
+
+    lateServices[numLateServices++] = service;
+    service->active = true;
+    service->start();
+    return true;
+}
+
+void Scheduler::tick()
+{
+    // Wait for the tick boundary
+    if(nextTick == 0) nextTick = TimeNow();
+    while(TimeNow() < nextTick);
+
+    tickStart = TimeNow();
+    nextTick += TICK_PERIOD;
+
+    // If we fell more than a tick behind don't try to catch up
+    if(nextTick < tickStart) nextTick = tickStart + TICK_PERIOD;
+
+    // Services first so tasks see fresh sensor data
+    for(int i = 0; i < numServices; i++)
+    {
+        services[i]->update();
+    }
+
+    // Step every task and retire the ones that finished
+    for(int i = 0; i < MAX_TASKS; i++)
+    {
+        Task *task = tasks[i];
+        if(task != 0 && task->update())
+        {
+            tasks[i] = 0;
+            task->active = false;
+            task->finish();
+        }
+    }
+
+    for(int i = 0; i < numLateServices; i++)
+    {
+        lateServices[i]->update();
+    }
+}
+
+void Scheduler::run(Task *task)
+{
+    // Wait for a free slot if everything is busy
+    while(!add(task)) tick();
+
+    while(task->active) tick();
+}
+
+bool Scheduler::runFor(Task *task, double seconds, bool (*stuck)())
+{
+    while(!add(task)) tick();
+
+    double deadline = TimeNow() + task->expected() + seconds;
+    while(task->active)
+    {
+        if(TimeNow() >= deadline)
+        {
+            cancel(task);
+            return false;
+        }
+        tick();
+
+        if(task->active && stuck && stuck())
+        {
+            cancel(task);
+            return false;
+        }
+    }
+    return true;
+}
+
+void Scheduler::waitAll()
+{
+    bool busy = true;
+    while(busy)
+    {
+        busy = false;
+        for(int i = 0; i < MAX_TASKS; i++)
+        {
+            if(tasks[i] != 0) busy = true;
+        }
+        if(busy) tick();
+    }
+}
+
+void Scheduler::sleep(double seconds)
+{
+    double end = TimeNow() + seconds;
+    while(TimeNow() < end) tick();
+}
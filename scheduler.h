@@ -0,0 +1,97 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+// Length of one scheduler tick in seconds
+#define TICK_PERIOD 0.005
+
+// Most tasks (and services) that can be active at once
+#define MAX_TASKS 8
+#define MAX_SERVICES 8
+
+// A resumable piece of work. Instead of spinning in a while loop the task
+// does one small step every time update() is called and returns true once
+// it is done, so several of them can share the robot at the same time.
+class Task
+{
+public:
+    Task();
+    virtual ~Task() {}
+
+    // Called once when the task is handed to the scheduler
+    virtual void start() {}
+
+    // Called once per tick, return true when the task is finished
+    virtual bool update() = 0;
+
+    // Called once after update() returned true or the task was cancelled
+    virtual void finish() {}
+
+    // Seconds the task should take if nothing goes wrong (known after start)
+    virtual double expected() const { return 0; }
+
+    // Called before a task that ran out of time is started again. Left alone
+    // the task just starts over, moves use it to carry on where they stopped.
+    virtual void retry() {}
+
+    // True while the task is owned by the scheduler
+    bool running() const { return active; }
+
+private:
+    friend class Scheduler;
+    bool active;
+};
+
+// Fixed tick cooperative scheduler. Services run every tick forever (sensor
+// sampling, display, ...), tasks run every tick until they report done.
+class Scheduler
+{
+public:
+    Scheduler();
+
+    // Start a task in the background, returns false if there is no room
+    bool add(Task *task);
+
+    // Stop a task before it is finished
+    void cancel(Task *task);
+
+    // Add something that runs every tick for the rest of the program
+    bool addService(Task *service);
+
+    // Same but runs after the tasks each tick. For slow things like the LCD,
+    // so they don't sit between the inputs being read and the tasks acting
+    // on them.
+    bool addLateService(Task *service);
+
+    // Wait for the next tick boundary and step everything once
+    void tick();
+
+    // Start a task and keep ticking until it is done
+    void run(Task *task);
+
+    // Like run() but gives up once the task is more than a number of seconds
+    // past what it expected to take, or as soon as stuck() says so (checked
+    // after every tick). Returns false if it had to cancel it.
+    bool runFor(Task *task, double seconds, bool (*stuck)() = 0);
+
+    // Keep ticking until every background task is done
+    void waitAll();
+
+    // Keep ticking for a number of seconds (use this instead of Sleep)
+    void sleep(double seconds);
+
+    // Time at the start of the current tick
+    double now() const { return tickStart; }
+
+private:
+    Task *tasks[MAX_TASKS];
+    Task *services[MAX_SERVICES];
+    int numServices;
+    Task *lateServices[MAX_SERVICES];
+    int numLateServices;
+    double nextTick;
+    double tickStart;
+};
+
+extern Scheduler scheduler;
+
+#endif // SCHEDULER_H
@@ -0,0 +1,36 @@
+#include "settingsfile.h"
+#include <FEHSD.h>
+#include <cstring>
+
+bool loadSettings(const char *name, const SettingsField *fields, int numFields, void *settings)
+{
+    FEHFile *file = SD.FOpen(name, "r");
+    if(!file) return false;
+
+    char key[32];
+    float value;
+    while(!SD.FEof(file) && SD.FScanf(file, "%31s %f", key, &value) == 2)
+    {
+        for(int i = 0; i < numFields; i++)
+        {
+            if(strcmp(key, fields[i].name) == 0) *(float *)((char *)settings + fields[i].offset) = value;
+        }
+    }
+
+    SD.FClose(file);
+    return true;
+}
+
+bool saveSettings(const char *name, const SettingsField *fields, int numFields, const void *settings)
+{
+    FEHFile *file = SD.FOpen(name, "w");
+    if(!file) return false;
+
+    for(int i = 0; i < numFields; i++)
+    {
+        SD.FPrintf(file, "%s %f\n", fields[i].name, *(const float *)((const char *)settings + fields[i].offset));
+    }
+
+    SD.FClose(file);
+    return true;
+}
@@ -0,0 +1,21 @@
+#ifndef SETTINGSFILE_H
+#define SETTINGSFILE_H
+
+#include <stddef.h>
+
+// Files of "name value" lines on the SD card, like the calibration profile
+// and the tuned settings. Each name goes to a float in a struct.
+struct SettingsField
+{
+    const char *name;
+    size_t offset; // of the float in the struct, offsetof(Struct, member)
+};
+
+// Read a file over the top of a struct, names it doesn't know are skipped so
+// old files still load. Returns false if there's no file.
+bool loadSettings(const char *name, const SettingsField *fields, int numFields, void *settings);
+
+// Write every field, returns false if the card couldn't be written
+bool saveSettings(const char *name, const SettingsField *fields, int numFields, const void *settings);
+
+#endif // SETTINGSFILE_H
@@ -0,0 +1,51 @@
+#include "stall.h"
+
+StallDetector::StallDetector(double startup)
+{
+    this->startup = startup;
+    reset();
+}
+
+void StallDetector::reset()
+{
+    lastExpected = 0;
+    startTime = 0;
+    slowSince = -1;
+    stuck = false;
+}
+
+void StallDetector::update(float expected, float measured, double now)
+{
+    // Nothing asked of it, nothing to be stuck on
+    if(expected == 0)
+    {
+        reset();
+        return;
+    }
+
+    // Starting, turning around or speeding up a lot takes the motor a moment
+    bool reversed = (expected > 0) != (lastExpected > 0);
+    float ask = expected > 0 ? expected : -expected;
+    float lastAsk = lastExpected > 0 ? lastExpected : -lastExpected;
+    if(lastExpected == 0 || reversed || ask > 2 * lastAsk)
+    {
+        startTime = now;
+        lastExpected = expected;
+    }
+    else if(ask < lastAsk)
+    {
+        // Keep the lowest it's been asked for since the start, so small
+        // steps up don't add up to a restart
+        lastExpected = expected;
+    }
+
+    if(now - startTime < startup || measured >= ask * STALL_FRACTION)
+    {
+        slowSince = -1;
+        stuck = false;
+        return;
+    }
+
+    if(slowSince < 0) slowSince = now;
+    stuck = now - slowSince >= STALL_TIME;
+}
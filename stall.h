@@ -0,0 +1,44 @@
+#ifndef STALL_H
+#define STALL_H
+
+// A shaft turning slower than this share of what its motor command should
+// give is stuck
+#define STALL_FRACTION 0.4
+
+// Seconds it has to stay that slow before we call it a stall
+#define STALL_TIME 0.1
+
+// Seconds a motor gets to spin up after it starts, turns around or is asked
+// for a lot more speed
+#define STALL_STARTUP 0.15
+
+// Watches one motor and its encoder for the shaft not turning when it should.
+// Checked every tick, so a jam shows up a tenth of a second or so after the
+// counts stop instead of when a deadline runs out.
+class StallDetector
+{
+public:
+    // A slow shaft can be given longer to spin up, the encoder gives no speed
+    // until its second count
+    StallDetector(double startup = STALL_STARTUP);
+
+    // Give it the speed the motor command should make in counts per second
+    // (signed like the command, 0 when the motor is off) and the speed the
+    // encoder measured, once a tick
+    void update(float expected, float measured, double now);
+
+    // Whether the shaft is stuck right now
+    bool stalled() const { return stuck; }
+
+    // Forget everything, the next command counts as a start
+    void reset();
+
+private:
+    double startup;
+    float lastExpected;
+    double startTime;
+    double slowSince;
+    bool stuck;
+};
+
+#endif // STALL_H
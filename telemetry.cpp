@@ -0,0 +1,55 @@
+#include "telemetry.h"
+#include <FEHSD.h>
+
+Telemetry::Telemetry(TelemetryRecord *records, int capacity)
+{
+    this->records = records;
+    this->capacity = capacity;
+    clear();
+}
+
+void Telemetry::clear()
+{
+    head = 0;
+    size = 0;
+    held = false;
+}
+
+void Telemetry::add(const TelemetryRecord &record)
+{
+    if(held) return;
+
+    records[head] = record;
+    head = (head + 1) % capacity;
+    if(size < capacity) size++;
+}
+
+const TelemetryRecord &Telemetry::get(int i) const
+{
+    return records[(head - size + i + capacity) % capacity];
+}
+
+bool Telemetry::dump(const char *name) const
+{
+    FEHFile *file = SD.FOpen(name, "w");
+    if(!file) return false;
+
+    SD.FPrintf(file, "%s %d %d\n", TELEMETRY_HEADER, (int)sizeof(TelemetryRecord), size);
+
+    // The SD library only writes text, so each record goes out as hex
+    for(int i = 0; i < size; i++)
+    {
+        const unsigned char *bytes = (const unsigned char *)&get(i);
+        char line[2 * sizeof(TelemetryRecord) + 1];
+        for(unsigned int j = 0; j < sizeof(TelemetryRecord); j++)
+        {
+            line[2 * j] = "0123456789abcdef"[bytes[j] >> 4];
+            line[2 * j + 1] = "0123456789abcdef"[bytes[j] & 15];
+        }
+        line[2 * sizeof(TelemetryRecord)] = 0;
+        SD.FPrintf(file, "%s\n", line);
+    }
+
+    SD.FClose(file);
+    return true;
+}
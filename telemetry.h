@@ -0,0 +1,80 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+// Records kept, the oldest get written over when it fills up. 56 KB, which
+// with a record every TELEMETRY_PERIOD covers a whole run.
+#define TELEMETRY_RECORDS 2048
+
+// Records kept of every tick, 11 KB for the last 2 s before the first thing
+// that went wrong (or the end of the run), fast enough to see a stop or a
+// switch bounce
+#define TELEMETRY_TICK_RECORDS 400
+
+// One sample of everything, 28 bytes laid out so there is no padding and the
+// robot and the host decoder agree on it
+struct TelemetryRecord
+{
+    uint32_t time; // milliseconds since the run started
+    uint16_t leftCounts;
+    uint16_t rightCounts;
+    uint16_t liftCounts;
+    uint16_t cds; // millivolts
+    int16_t rpsX; // tenths of an inch
+    int16_t rpsY;
+    int16_t rpsHeading; // tenths of a degree
+    int8_t leftPercent; // motor commands
+    int8_t rightPercent;
+    int8_t liftPercent;
+    uint8_t switches; // TELEMETRY_* bits
+    uint8_t segment; // mission step running
+    uint8_t step;
+    uint16_t battery; // filtered pack millivolts, 0 before the first reading
+    uint16_t scale; // battery compensation on the motor commands, in thousandths
+};
+
+// Bits in TelemetryRecord::switches, set when the switch is pressed
+#define TELEMETRY_BACK_LEFT 1
+#define TELEMETRY_BACK_RIGHT 2
+#define TELEMETRY_LIFT_BOTTOM 4
+
+// Files the run and the last ticks get dumped to on the SD card
+#define TELEMETRY_FILE "TELEM.TXT"
+#define TELEMETRY_TICK_FILE "TICKS.TXT"
+
+// First line of a dump, followed by one line of hex per record
+#define TELEMETRY_HEADER "TELEMETRY 2"
+
+// Fixed size ring buffer of samples, in memory handed to it. Adding a record
+// is a copy into memory that is already there, so it is cheap enough to do
+// every tick, and the whole thing is written out after the run.
+class Telemetry
+{
+public:
+    Telemetry(TelemetryRecord *records, int capacity);
+
+    // Forget everything recorded so far and start taking records again
+    void clear();
+
+    void add(const TelemetryRecord &record);
+
+    // Stop taking records, what's there is kept until clear()
+    void hold() { held = true; }
+
+    // Records in the buffer, 0 is the oldest
+    int count() const { return size; }
+    const TelemetryRecord &get(int i) const;
+
+    // Write every record to the SD card, returns false if it couldn't
+    bool dump(const char *name) const;
+
+private:
+    TelemetryRecord *records;
+    int capacity;
+    int head;
+    int size;
+    bool held;
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,73 @@
+#include "trace.h"
+#include <FEHSD.h>
+#include <FEHUtility.h>
+
+// The one trace shared by the whole program
+SensorTrace sensorTrace;
+
+SensorTrace::SensorTrace()
+{
+    size = 0;
+    on = false;
+    tickTime = -1;
+}
+
+void SensorTrace::start()
+{
+    size = 0;
+    on = RECORD_TRACE;
+#if RECORD_TRACE
+    for(int i = 0; i < TRACE_SOURCES; i++)
+    {
+        for(int j = 0; j < TRACE_CHANNELS; j++) known[i][j] = false;
+    }
+#endif
+}
+
+void SensorTrace::add(int source, int channel, float value)
+{
+#if RECORD_TRACE
+    if(!on || size >= TRACE_RECORDS || channel < 0 || channel >= TRACE_CHANNELS) return;
+
+    // Round to what a record holds, then drop it if it hardly changed (a
+    // motor stopping always counts)
+    int16_t stored = traceValue(source, channel, value);
+    if(source != TRACE_RESET && known[source][channel] && !traceChanged(source, last[source][channel], stored)) return;
+
+    last[source][channel] = stored;
+    known[source][channel] = true;
+
+    TraceRecord &record = records[size++];
+    record.time = (uint32_t)((tickTime >= 0 ? tickTime : TimeNow()) * 1000000);
+    record.source = source;
+    record.channel = channel;
+    record.value = stored;
+#endif
+}
+
+bool SensorTrace::dump(const char *name) const
+{
+    FEHFile *file = SD.FOpen(name, "w");
+    if(!file) return false;
+
+    SD.FPrintf(file, "%s %d %d\n", TRACE_HEADER, (int)sizeof(TraceRecord), size);
+
+#if RECORD_TRACE
+    // Hex like the telemetry dump, the SD library only writes text
+    for(int i = 0; i < size; i++)
+    {
+        const unsigned char *bytes = (const unsigned char *)&records[i];
+        char line[2 * sizeof(TraceRecord) + 1];
+        for(unsigned int j = 0; j < sizeof(TraceRecord); j++)
+        {
+            line[2 * j] = "0123456789abcdef"[bytes[j] >> 4];
+            line[2 * j + 1] = "0123456789abcdef"[bytes[j] & 15];
+        }
+        line[2 * sizeof(TraceRecord)] = 0;
+        SD.FPrintf(file, "%s\n", line);
+    }
+#endif
+
+    SD.FClose(file);
+    return true;
+}
@@ -0,0 +1,246 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <FEHIO.h>
+#include <FEHWONKA.h>
+#include <FEHBattery.h>
+
+// Record every sensor read and motor command from power on, written to
+// TRACE_FILE after each run so host/robot-replay can play it back. With it
+// off the trace takes no memory.
+#ifndef RECORD_TRACE
+#define RECORD_TRACE 0
+#endif
+
+// Records kept, recording stops when it fills up so a trace always starts at
+// power on and can be fed back from there. This is a partial trace: 64 KB
+// covers about the first 20 s of driving, not a whole run.
+#define TRACE_RECORDS 8192
+
+// File a trace gets dumped to on the SD card
+#define TRACE_FILE "TRACE.TXT"
+
+// First line of a dump, followed by one line of hex per record
+#define TRACE_HEADER "TRACE 1"
+
+// Where a record came from. Reads only get recorded when the value changed
+// since the last read of the same thing, so the trace gives the value of
+// every read at any time without filling up on repeats. Motor commands are
+// recorded the same way so a replay can be checked against them.
+enum TraceSource
+{
+    TRACE_COUNTS, // encoder counts, channel is the pin
+    TRACE_RESET, // encoder reset, every one is kept
+    TRACE_DIGITAL, // digital pin, channel is the pin
+    TRACE_ANALOG, // analog pin in millivolts, channel is the pin
+    TRACE_BUTTON, // pressed, channel 0 left, 1 middle, 2 right
+    TRACE_RPS, // channels below
+    TRACE_MOTOR, // percent in hundredths, channel is the motor port
+    TRACE_BATTERY, // pack voltage in millivolts, channel 0
+    TRACE_SOURCES
+};
+
+// RPS channels
+#define TRACE_RPS_X 0 // hundredths of an inch
+#define TRACE_RPS_Y 1
+#define TRACE_RPS_HEADING 2 // tenths of a degree
+#define TRACE_RPS_OVEN 3
+
+#define TRACE_CHANNELS 32
+
+// One read or command, 8 bytes with no padding so the robot and the host agree
+struct TraceRecord
+{
+    uint32_t time; // microseconds on the robot clock
+    uint8_t source; // TraceSource
+    uint8_t channel;
+    int16_t value; // scaled by traceScale()
+};
+
+// Smallest changes worth a record, in record units. The CdS cell and the
+// wheel PID move a little every tick, and anything under these is noise to
+// the code reading them. A replay only sees those to within these steps.
+#define TRACE_ANALOG_STEP 20 // millivolts
+#define TRACE_MOTOR_STEP 50 // hundredths of a percent
+
+// What a value is multiplied by to go into a record
+inline float traceScale(int source, int channel)
+{
+    if(source == TRACE_ANALOG || source == TRACE_BATTERY) return 1000;
+    if(source == TRACE_MOTOR) return 100;
+    if(source == TRACE_RPS && channel == TRACE_RPS_HEADING) return 10;
+    if(source == TRACE_RPS && channel != TRACE_RPS_OVEN) return 100;
+    return 1;
+}
+
+// A value the way a record holds it
+inline int16_t traceValue(int source, int channel, float value)
+{
+    float scaled = value * traceScale(source, channel);
+    if(scaled > 32767) scaled = 32767;
+    if(scaled < -32768) scaled = -32768;
+    return (int16_t)(scaled < 0 ? scaled - .5f : scaled + .5f);
+}
+
+// Whether a value moved far enough from the last one recorded to get a record
+inline bool traceChanged(int source, int16_t last, int16_t value)
+{
+    if(value == last) return false;
+    if(value == 0) return true;
+
+    int step = source == TRACE_ANALOG || source == TRACE_BATTERY ? TRACE_ANALOG_STEP : source == TRACE_MOTOR ? TRACE_MOTOR_STEP : 1;
+    return value - last >= step || last - value >= step;
+}
+
+// Sensor reads and motor commands in order, kept in memory while the robot
+// runs and written out afterwards like telemetry
+class SensorTrace
+{
+public:
+    SensorTrace();
+
+    // Forget everything and record from now on
+    void start();
+
+    // Stop recording, what's there is kept
+    void stop() { on = false; }
+
+    // Stamp records with the time of the last tick from here on instead of
+    // reading the clock for each one, so recording doesn't slow the run
+    // down. Reads from before the first tick and after endTick() (the menus)
+    // read the clock.
+    void startTick(double now) { tickTime = now; }
+    void endTick() { tickTime = -1; }
+
+    bool recording() const { return on; }
+    bool full() const { return size >= TRACE_RECORDS; }
+
+    // Note a value read or a command given
+    void add(int source, int channel, float value);
+
+    int count() const { return size; }
+
+    // Write every record to the SD card, returns false if it couldn't
+    bool dump(const char *name) const;
+
+private:
+    int size;
+    bool on;
+    double tickTime;
+
+#if RECORD_TRACE
+    TraceRecord records[TRACE_RECORDS];
+
+    // Last value kept for each source and channel, for dropping repeats
+    int16_t last[TRACE_SOURCES][TRACE_CHANNELS];
+    bool known[TRACE_SOURCES][TRACE_CHANNELS];
+#endif
+};
+
+// The one trace shared by the whole program
+extern SensorTrace sensorTrace;
+
+// The FEH inputs with every read going into the trace. Declare the robot's
+// hardware with these and nothing else changes.
+
+class TracedEncoder : public FEHEncoder
+{
+public:
+    TracedEncoder(FEHIO::FEHIOPin pin) : FEHEncoder(pin), channel(pin) {}
+
+    int Counts()
+    {
+        int counts = FEHEncoder::Counts();
+        sensorTrace.add(TRACE_COUNTS, channel, counts);
+        return counts;
+    }
+
+    void ResetCounts()
+    {
+        sensorTrace.add(TRACE_RESET, channel, 0);
+        FEHEncoder::ResetCounts();
+    }
+
+private:
+    int channel;
+};
+
+class TracedDigitalPin : public DigitalInputPin
+{
+public:
+    TracedDigitalPin(FEHIO::FEHIOPin pin) : DigitalInputPin(pin), channel(pin) {}
+
+    int Value()
+    {
+        int value = DigitalInputPin::Value();
+        sensorTrace.add(TRACE_DIGITAL, channel, value);
+        return value;
+    }
+
+private:
+    int channel;
+};
+
+class TracedAnalogPin : public AnalogInputPin
+{
+public:
+    TracedAnalogPin(FEHIO::FEHIOPin pin) : AnalogInputPin(pin), channel(pin) {}
+
+    float Value()
+    {
+        float value = AnalogInputPin::Value();
+        sensorTrace.add(TRACE_ANALOG, channel, value);
+        return value;
+    }
+
+private:
+    int channel;
+};
+
+class TracedButtons : public ButtonBoard
+{
+public:
+    TracedButtons(FEHIO::FEHIOPort port) : ButtonBoard(port) {}
+
+    int LeftPressed() { return traced(0, ButtonBoard::LeftPressed()); }
+    int MiddlePressed() { return traced(1, ButtonBoard::MiddlePressed()); }
+    int RightPressed() { return traced(2, ButtonBoard::RightPressed()); }
+
+private:
+    int traced(int button, int pressed)
+    {
+        sensorTrace.add(TRACE_BUTTON, button, pressed);
+        return pressed;
+    }
+};
+
+// The FEH library has the one battery monitor already, this reads it
+class TracedBattery
+{
+public:
+    float Voltage()
+    {
+        float volts = Battery.Voltage();
+        sensorTrace.add(TRACE_BATTERY, 0, volts);
+        return volts;
+    }
+};
+
+class TracedRPS : public FEHWONKA
+{
+public:
+    float X() { return traced(TRACE_RPS_X, FEHWONKA::X()); }
+    float Y() { return traced(TRACE_RPS_Y, FEHWONKA::Y()); }
+    float Heading() { return traced(TRACE_RPS_HEADING, FEHWONKA::Heading()); }
+    int Oven() { return (int)traced(TRACE_RPS_OVEN, FEHWONKA::Oven()); }
+
+private:
+    float traced(int channel, float value)
+    {
+        sensorTrace.add(TRACE_RPS, channel, value);
+        return value;
+    }
+};
+
+#endif // TRACE_H
@@ -0,0 +1,18 @@
+#include "tuning.h"
+#include "settingsfile.h"
+
+// Name of every setting in the file and where it goes
+#define TUNING_FIELD(name, start, low, high) { #name, offsetof(Tuning, name) },
+static const SettingsField fields[] = { TUNING_SETTINGS(TUNING_FIELD) };
+
+static const int numFields = sizeof(fields) / sizeof(SettingsField);
+
+bool loadTuning(const char *name, Tuning &tuning)
+{
+    return loadSettings(name, fields, numFields, &tuning);
+}
+
+bool saveTuning(const char *name, const Tuning &tuning)
+{
+    return saveSettings(name, fields, numFields, &tuning);
+}
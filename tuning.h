@@ -0,0 +1,51 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+// File the tuned settings live in on the SD card
+#define TUNING_FILE "TUNE.TXT"
+
+// Every tuned setting, with its compiled-in value and the range host/robot-tune
+// may search. This list is the only place they're written down, the robot and
+// the tuner both build theirs from it.
+//
+//   speedHigh    percent for drives and pivots
+//   speedLow     percent for backing into walls
+//   driveAccel   counts per second per second
+//   pivotAccel
+//   stopLead     seconds the wheels keep rolling after we cut the motors
+//   breakTime    seconds to sit still between moves
+//   squareHold   percent leaning on a wall with the side that's there
+//   squareSwing  seconds for the second switch to close after the first
+//   turnRadius   inches for corners on planned paths
+#define TUNING_SETTINGS(SETTING) \
+    SETTING(speedHigh, 98, 40, 100) \
+    SETTING(speedLow, 87, 30, 90) \
+    SETTING(driveAccel, 195, 40, 300) \
+    SETTING(pivotAccel, 100, 30, 250) \
+    SETTING(stopLead, .12, 0, .15) \
+    SETTING(breakTime, .43, 0, .8) \
+    SETTING(squareHold, 31, 12, 45) \
+    SETTING(squareSwing, .33, .1, 1.5) \
+    SETTING(turnRadius, 9, 4, 16)
+
+// Speeds and timings picked by host/robot-tune instead of one run at a time.
+// Same "name value" file as the calibration profile, anything missing from it
+// keeps the compiled-in value.
+struct Tuning
+{
+#define TUNING_MEMBER(name, start, low, high) float name;
+    TUNING_SETTINGS(TUNING_MEMBER)
+#undef TUNING_MEMBER
+};
+
+// The compiled-in values, for initializing a Tuning
+#define TUNING_START(name, start, low, high) start,
+#define TUNING_DEFAULTS { TUNING_SETTINGS(TUNING_START) }
+
+// Read settings over the top of what's there, returns false if there's no file
+bool loadTuning(const char *name, Tuning &tuning);
+
+// Write the settings, returns false if the card couldn't be written
+bool saveTuning(const char *name, const Tuning &tuning);
+
+#endif // TUNING_H
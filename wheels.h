@@ -0,0 +1,19 @@
+#ifndef WHEELS_H
+#define WHEELS_H
+
+// Drive wheel settings, here so host/robot-bench runs the same numbers as the
+// robot
+
+// Encoder settings (until the robot has been calibrated)
+#define COUNTS_PER_WHEEL 32.0
+#define WHEEL_CIRCUMFERENCE 2.75 * 3.14159
+
+#define COUNTS_TO_PIVOT 19
+
+// Wheel speed PID, on top of the feed forward from the calibration
+#define WHEEL_KP 0.8
+#define WHEEL_KI 2.0
+#define WHEEL_KD 0
+#define WHEEL_CORRECTION_MAX 40 // most percent the controller may add or take away
+
+#endif // WHEELS_H